@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Driver which runs every native benchmark in a single process.
+ *
+ * Cases are read from a JSON config in the same format runner.py uses
+ * (see config_example.json). Each dataset is loaded only once and shared
+ * between all cases using it, and DAAL is only initialized once.
+ */
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <cstdlib>
+
+#define DAAL_DATA_TYPE double
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "json.hpp"
+#include "calibrate.hpp"
+#include "CLI11.hpp"
+
+#include "dbscan.hpp"
+#include "decision_forest_clsf.hpp"
+#include "decision_forest_regr.hpp"
+#include "distances.hpp"
+#include "elastic_net.hpp"
+#include "em_gmm.hpp"
+#include "hyper_search.hpp"
+#include "kmeans.hpp"
+#include "linear.hpp"
+#include "log_reg_lbfgs.hpp"
+#include "multi_tenant.hpp"
+#include "naive_bayes.hpp"
+#include "online.hpp"
+#include "pca.hpp"
+#include "ridge.hpp"
+#include "svm.hpp"
+
+
+typedef int (*bench_main_t)(int argc, char *argv[]);
+
+/*
+ * Benchmarks are registered under the algorithm names used in the config,
+ * which are the names of the python benchmarks.
+ */
+const std::map<std::string, bench_main_t> benchmarks = {
+    {"dbscan", run_benchmark<dbscan_bench>},
+    {"df_clsf", run_benchmark<df_clsf_bench>},
+    {"df_regr", run_benchmark<df_regr_bench>},
+    {"distances", run_benchmark<distances_bench>},
+    {"elastic_net", run_benchmark<elastic_net_bench>},
+    {"em_gmm", run_benchmark<em_gmm_bench>},
+    {"hyper_search", run_benchmark<hyper_search_bench>},
+    {"kmeans", run_benchmark<kmeans_bench>},
+    {"linear", run_benchmark<linear_bench>},
+    {"log_reg", run_benchmark<log_reg_lbfgs_bench>},
+    {"multi_tenant", run_benchmark<multi_tenant_bench>},
+    {"naive_bayes", run_benchmark<naive_bayes_bench>},
+    {"online", run_benchmark<online_bench>},
+    {"pca", run_benchmark<pca_bench>},
+    {"ridge", run_benchmark<ridge_bench>},
+    {"svm", run_benchmark<svm_bench>},
+};
+
+
+bool file_exists(const std::string &fn) {
+
+    return std::ifstream(fn).good();
+
+}
+
+
+/*
+ * Get the arguments naming the files of a dataset from the config,
+ * generating synthetic datasets with make_datasets.py if needed.
+ * File names of synthetic datasets match the ones runner.py uses.
+ *
+ * Returns false if the dataset can't be used.
+ */
+bool get_dataset_args(const json_value &dataset, const std::string &seed,
+                      bool generate, std::vector<std::string> &args) {
+
+    std::string source = dataset["source"].to_string();
+    const json_value &training = dataset["training"];
+
+    if (source == "npy") {
+        args.push_back("--file-X-train");
+        args.push_back(training["x"].to_string());
+        if (training.has("y")) {
+            args.push_back("--file-y-train");
+            args.push_back(training["y"].to_string());
+        }
+        return true;
+    }
+
+    if (source != "synthetic") {
+        std::cerr << "error: unsupported dataset source '" << source
+                  << "'. Only synthetic and npy datasets are supported."
+                  << std::endl;
+        return false;
+    }
+
+    std::string type = dataset["type"].to_string();
+    std::string samples = training["n_samples"].to_string();
+    std::string features = dataset["n_features"].to_string();
+    std::string n_classes;
+    if (dataset.has("n_classes")) {
+        n_classes = dataset["n_classes"].to_string();
+    } else if (dataset.has("n_clusters")) {
+        n_classes = dataset["n_clusters"].to_string();
+    }
+
+    std::string file_prefix = "data/synthetic-" + type
+        + (n_classes.empty() ? "" : "-" + n_classes) + '-';
+    std::string file_postfix = '-' + samples + 'x' + features + ".npy";
+
+    std::string filex = file_prefix + "X-train" + file_postfix;
+    std::string filey = file_prefix + "y-train" + file_postfix;
+    std::string filei = file_prefix + "init" + file_postfix;
+    std::string filet = file_prefix + "threshold" + file_postfix;
+    bool has_y = (type != "kmeans" && type != "blobs");
+
+    if (generate && !file_exists(filex)) {
+        if (type == "blobs") {
+            std::cerr << "error: " << filex << " not found. Blobs can only "
+                      << "be generated by runner.py." << std::endl;
+            return false;
+        }
+
+        std::ostringstream command;
+        command << "python make_datasets.py -f " << features << " -s "
+                << samples << " -d " << seed << ' ' << type;
+        if (!n_classes.empty())
+            command << " -c " << n_classes;
+        command << " -x " << filex;
+        if (has_y)
+            command << " -y " << filey;
+        if (type == "kmeans")
+            command << " -i " << filei << " -t " << filet;
+
+        if (std::system(command.str().c_str()) != 0) {
+            std::cerr << "error: failed to generate " << filex << std::endl;
+            return false;
+        }
+    }
+
+    if (type == "kmeans") {
+        args.push_back("--filei");
+        args.push_back(filei);
+    }
+    args.push_back("--file-X-train");
+    args.push_back(filex);
+    if (has_y) {
+        args.push_back("--file-y-train");
+        args.push_back(filey);
+    }
+
+    return true;
+
+}
+
+
+/*
+ * Expand a set of parameters into the arguments of every case, iterating
+ * over all combinations of parameter values like runner.py does.
+ */
+std::vector<std::vector<std::string>>
+generate_cases(const json_value &params) {
+
+    std::vector<std::vector<std::string>> cases(1);
+
+    for (auto &param : params.object) {
+        const std::string &name = param.first;
+        if (name == "algorithm" || name == "dataset" || name == "lib")
+            continue;
+
+        std::vector<json_value> values;
+        if (param.second.is_array()) {
+            values = param.second.array;
+        } else {
+            values.push_back(param.second);
+        }
+
+        std::vector<std::vector<std::string>> new_cases;
+        for (auto &value : values) {
+            for (auto c : cases) {
+                c.push_back((name.size() == 1 ? "-" : "--") + name);
+                c.push_back(value.to_string());
+                new_cases.push_back(c);
+            }
+        }
+        cases = new_cases;
+    }
+
+    return cases;
+
+}
+
+
+int main(int argc, char *argv[]) {
+
+    CLI::App app("Native benchmark driver running all Intel(R) DAAL "
+                 "benchmarks from a config in a single process");
+
+    std::string batch, arch, prefix;
+    int num_threads;
+    bool header, verbose;
+    add_common_args(app, batch, arch, prefix, num_threads, header, verbose);
+
+    std::string config_fn;
+    app.add_option("-c,--config", config_fn, "Path to configuration file")
+        ->required()->check(CLI::ExistingFile);
+
+    std::string results_file;
+    app.add_option("--store-results", results_file,
+                   "Append raw timing samples to this results store, for "
+                   "bench-compare (e.g. " DEFAULT_RESULTS_STORE ")");
+
+    bool roofline = false;
+    app.add_flag("--roofline", roofline,
+                 "Report throughput and bandwidth as a fraction of the "
+                 "peak of this host, calibrating it first if needed");
+
+    std::string calibration_file = DEFAULT_CALIBRATION_STORE;
+    app.add_option("--calibration", calibration_file,
+                   "Calibration store to read peaks from", true);
+
+    struct calibration_options calibration_opts;
+    add_calibration_args(app, calibration_opts);
+
+    std::string trace_file;
+    app.add_option("--trace", trace_file,
+                   "Write a timeline of all benchmark phases to this file in "
+                   "Chrome Trace Event format");
+
+    bool utilization = false;
+    app.add_flag("--utilization", utilization,
+                 "Report how busy TBB threads are in timed phases");
+
+    bool profile = false;
+    app.add_flag("--profile", profile,
+                 "Sample call stacks in timed phases and report hotspots "
+                 "after each case");
+
+    int profile_top = 10;
+    app.add_option("--profile-top", profile_top,
+                   "Number of functions to report per phase with --profile",
+                   true)->check(CLI::PositiveNumber);
+
+    bool dummy_run = false;
+    app.add_flag("--dummy-run", dummy_run,
+                 "Print cases without running benchmarks or generating "
+                 "datasets");
+
+    CLI11_PARSE(app, argc, argv);
+
+    // Cases record spans into the same trace, which is written at the end
+    if (!trace_file.empty())
+        tracing_enabled = true;
+
+    json_value config;
+    try {
+        config = load_json(config_fn);
+    } catch (const std::runtime_error &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Benchmarks should ignore config parameters meant for other libraries
+    allow_extra_args = true;
+
+    std::vector<std::string> common_args = {
+        "--batch", batch, "--arch", arch, "--prefix", prefix,
+        "--num-threads", std::to_string(num_threads)
+    };
+    if (verbose)
+        common_args.push_back("--verbose");
+    if (utilization)
+        common_args.push_back("--utilization");
+    if (profile) {
+        common_args.push_back("--profile");
+        common_args.push_back("--profile-top");
+        common_args.push_back(std::to_string(profile_top));
+    }
+    if (!results_file.empty()) {
+        common_args.push_back("--store-results");
+        common_args.push_back(results_file);
+    }
+
+    if (roofline && !dummy_run) {
+        int daal_threads = set_threads(num_threads);
+        calibration_record calibration;
+        if (!find_calibration(calibration_file, daal_threads, calibration)) {
+            if (verbose) {
+                std::cout << "@ Calibrating this host with " << daal_threads
+                          << " threads" << std::endl;
+            }
+            calibration = calibrate(daal_threads, calibration_opts, verbose);
+            if (!append_record(calibration_file, calibration))
+                return EXIT_FAILURE;
+        }
+    }
+    if (roofline) {
+        common_args.push_back("--roofline");
+        common_args.push_back("--calibration");
+        common_args.push_back(calibration_file);
+    }
+
+    std::map<std::string, bool> header_printed;
+    int status = EXIT_SUCCESS;
+
+    for (auto &case_set : config["cases"].array) {
+
+        // Parameters from the case override common parameters
+        json_value params = config["common"];
+        params.kind = json_value::object_kind;
+        for (auto &param : case_set.object) {
+            bool found = false;
+            for (auto &common_param : params.object) {
+                if (common_param.first == param.first) {
+                    common_param.second = param.second;
+                    found = true;
+                }
+            }
+            if (!found)
+                params.object.push_back(param);
+        }
+
+        std::string algorithm = params["algorithm"].to_string();
+        auto bench = benchmarks.find(algorithm);
+        if (bench == benchmarks.end()) {
+            if (verbose) {
+                std::cout << "@ Skipping " << algorithm
+                          << ": no native benchmark" << std::endl;
+            }
+            continue;
+        }
+
+        std::string seed = params.has("seed") ? params["seed"].to_string()
+                                              : "777";
+        auto cases = generate_cases(params);
+
+        for (auto &dataset : case_set["dataset"].array) {
+
+            std::vector<std::string> dataset_args;
+            if (!get_dataset_args(dataset, seed, !dummy_run, dataset_args)) {
+                status = EXIT_FAILURE;
+                continue;
+            }
+
+            for (auto &case_args : cases) {
+
+                std::vector<std::string> args = {"bench " + algorithm};
+                args.insert(args.end(), common_args.begin(),
+                            common_args.end());
+                if (header && !header_printed[algorithm]) {
+                    args.push_back("--header");
+                    header_printed[algorithm] = true;
+                }
+                args.insert(args.end(), dataset_args.begin(),
+                            dataset_args.end());
+                args.insert(args.end(), case_args.begin(), case_args.end());
+
+                if (verbose || dummy_run) {
+                    std::cout << "@";
+                    for (auto &arg : args)
+                        std::cout << ' ' << arg;
+                    std::cout << std::endl;
+                }
+                if (dummy_run)
+                    continue;
+
+                std::vector<char *> case_argv;
+                for (auto &arg : args)
+                    case_argv.push_back(&arg[0]);
+                case_argv.push_back(NULL);
+
+                std::string command;
+                for (auto &arg : args)
+                    command += (command.empty() ? "" : " ") + arg;
+                trace_span span("case", command);
+
+                int case_status;
+                try {
+                    case_status = bench->second(args.size(),
+                                                case_argv.data());
+                } catch (const std::exception &e) {
+                    std::cerr << "error: " << algorithm << " failed: "
+                              << e.what() << std::endl;
+                    case_status = EXIT_FAILURE;
+                }
+                if (case_status != 0)
+                    status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (!trace_file.empty() && !write_trace(trace_file))
+        status = EXIT_FAILURE;
+
+    return status;
+
+}
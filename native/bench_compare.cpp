@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Compare two batches of results in the results store written by
+ * benchmarks run with --store-results, flagging significant regressions
+ * and improvements.
+ *
+ * For each function measured in both batches with the same parameters,
+ * data, thread count and host, the raw timing samples are compared with
+ * a two-sided Mann-Whitney U test. A change is flagged when it is
+ * significant at the given level AND the medians differ by more than
+ * the threshold, so that noise isn't reported as a change and tiny but
+ * consistent differences aren't either. Functions with too few samples
+ * for the test to ever reach the significance level are reported as
+ * insufficient_samples rather than unchanged.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+#include "CLI11.hpp"
+#include "results.hpp"
+
+
+/* Median of samples, which must not be empty */
+double median(std::vector<double> x) {
+
+    std::sort(x.begin(), x.end());
+    size_t n = x.size();
+    return n % 2 ? x[n / 2] : (x[n / 2 - 1] + x[n / 2]) / 2;
+
+}
+
+
+/*
+ * Two-sided Mann-Whitney U test, using the normal approximation with
+ * tie and continuity correction.
+ *
+ * Parameters
+ * ----------
+ * a, b : const std::vector<double> &
+ *     Samples to compare
+ *
+ * Returns
+ * -------
+ * double
+ *     p-value for the hypothesis that a and b come from the same
+ *     distribution
+ */
+double mann_whitney_p(const std::vector<double> &a,
+                      const std::vector<double> &b) {
+
+    size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if (n1 == 0 || n2 == 0)
+        return 1.;
+
+    // Pool samples, remembering which came from a
+    std::vector<std::pair<double, bool>> pooled;
+    for (double x : a)
+        pooled.emplace_back(x, true);
+    for (double x : b)
+        pooled.emplace_back(x, false);
+    std::sort(pooled.begin(), pooled.end());
+
+    // Sum ranks of a, giving ties their average rank
+    double rank_sum = 0., tie_term = 0.;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i;
+        while (j < n && pooled[j].first == pooled[i].first)
+            j++;
+        double rank = (i + 1 + j) / 2.;
+        double t = j - i;
+        tie_term += t * t * t - t;
+        for (size_t k = i; k < j; k++)
+            if (pooled[k].second)
+                rank_sum += rank;
+        i = j;
+    }
+
+    double u = rank_sum - n1 * (n1 + 1) / 2.;
+    double mu = n1 * n2 / 2.;
+    double sigma = std::sqrt(n1 * n2 / 12.
+                             * ((n + 1) - tie_term / (n * (n - 1.))));
+    if (sigma == 0.)
+        return 1.;
+
+    double z = (std::fabs(u - mu) - 0.5) / sigma;
+    if (z < 0.)
+        z = 0.;
+    return std::erfc(z / std::sqrt(2.));
+
+}
+
+
+/*
+ * Smallest p-value mann_whitney_p can return for samples of sizes n1 and
+ * n2, when they don't overlap at all. Comparisons of fewer samples than
+ * needed to get below the significance level can't flag anything.
+ */
+double min_mann_whitney_p(size_t n1, size_t n2) {
+
+    if (n1 == 0 || n2 == 0)
+        return 1.;
+    double n = n1 + n2;
+    double sigma = std::sqrt(n1 * n2 / 12. * (n + 1));
+    double z = std::max(n1 * n2 / 2. - 0.5, 0.) / sigma;
+    return std::erfc(z / std::sqrt(2.));
+
+}
+
+
+int main(int argc, char *argv[]) {
+
+    CLI::App app("Compare native benchmark results from two batches in the "
+                 "results store");
+
+    std::string store = DEFAULT_RESULTS_STORE;
+    app.add_option("-s,--store", store, "Results store to read", true)
+        ->check(CLI::ExistingFile);
+
+    std::string baseline;
+    app.add_option("-b,--baseline", baseline,
+                   "Batch to use as the baseline. Defaults to the batch "
+                   "before the candidate.");
+
+    std::string candidate;
+    app.add_option("-c,--candidate", candidate,
+                   "Batch to compare against the baseline. Defaults to the "
+                   "last batch in the store.");
+
+    double threshold = 5.;
+    app.add_option("-t,--threshold", threshold,
+                   "Minimum change of the median time to flag, in percent",
+                   true)->check(CLI::Range(0., 1e9));
+
+    double alpha = 0.05;
+    app.add_option("--alpha", alpha,
+                   "Significance level. Functions whose sample counts "
+                   "can't give a p-value below it, even when the batches "
+                   "don't overlap, are reported as insufficient_samples",
+                   true)
+        ->check(CLI::Range(0., 1.));
+
+    bool all = false;
+    app.add_flag("--all", all, "Also output functions which didn't change");
+
+    bool header = false;
+    app.add_flag("--header", header, "Output CSV header");
+
+    CLI11_PARSE(app, argc, argv);
+
+    std::vector<result_record> records;
+    try {
+        records = load_records<result_record>(store);
+    } catch (const std::runtime_error &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Batches in the order they were stored
+    std::vector<std::string> batches;
+    for (auto &r : records)
+        if (std::find(batches.begin(), batches.end(), r.batch)
+                == batches.end())
+            batches.push_back(r.batch);
+
+    if (candidate.empty()) {
+        if (batches.empty()) {
+            std::cerr << "error: " << store << " is empty" << std::endl;
+            return EXIT_FAILURE;
+        }
+        candidate = batches.back();
+    }
+    if (baseline.empty()) {
+        auto it = std::find(batches.begin(), batches.end(), candidate);
+        if (it == batches.begin() || it == batches.end()) {
+            std::cerr << "error: no batch before " << candidate
+                      << " to use as the baseline" << std::endl;
+            return EXIT_FAILURE;
+        }
+        baseline = *(it - 1);
+    }
+
+    // Samples of repeated runs within a batch are pooled
+    std::map<std::string, result_record> base_results, cand_results;
+    std::vector<std::string> keys;
+    for (auto &r : records) {
+        // Records without timing samples can't be compared
+        if (r.samples.empty())
+            continue;
+        std::map<std::string, result_record> *results;
+        if (r.batch == baseline) {
+            results = &base_results;
+        } else if (r.batch == candidate) {
+            results = &cand_results;
+            if (!cand_results.count(r.key()))
+                keys.push_back(r.key());
+        } else {
+            continue;
+        }
+
+        auto it = results->find(r.key());
+        if (it == results->end()) {
+            (*results)[r.key()] = r;
+        } else {
+            it->second.samples.insert(it->second.samples.end(),
+                                      r.samples.begin(), r.samples.end());
+        }
+    }
+
+    if (header) {
+        std::cout << "function,params,size,threads,baseline_version,"
+                     "candidate_version,baseline_median,candidate_median,"
+                     "change_percent,p_value,verdict" << std::endl;
+    }
+
+    size_t n_regressions = 0, n_improvements = 0, n_unmatched = 0;
+    size_t n_insufficient = 0;
+    for (auto &key : keys) {
+        auto base = base_results.find(key);
+        if (base == base_results.end()) {
+            n_unmatched++;
+            continue;
+        }
+        const result_record &b = base->second, &c = cand_results[key];
+
+        double base_median = median(b.samples);
+        double cand_median = median(c.samples);
+        double change = (cand_median - base_median) / base_median * 100.;
+        double p = mann_whitney_p(b.samples, c.samples);
+
+        std::string verdict = "same";
+        if (min_mann_whitney_p(b.samples.size(), c.samples.size())
+                >= alpha) {
+            verdict = "insufficient_samples";
+            n_insufficient++;
+        } else if (p < alpha && change > threshold) {
+            verdict = "regression";
+            n_regressions++;
+        } else if (p < alpha && change < -threshold) {
+            verdict = "improvement";
+            n_improvements++;
+        } else if (!all) {
+            continue;
+        }
+
+        std::cout << c.function << ",\"" << c.params << "\"," << c.size
+                  << ',' << c.threads << ',' << b.version << ','
+                  << c.version << ',' << base_median << ',' << cand_median
+                  << ',' << change << ',' << p << ',' << verdict
+                  << std::endl;
+    }
+
+    std::cerr << "@ " << baseline << " -> " << candidate << ": "
+              << n_regressions << " regressions, " << n_improvements
+              << " improvements";
+    if (n_unmatched > 0)
+        std::cerr << ", " << n_unmatched << " without a baseline";
+    if (n_insufficient > 0)
+        std::cerr << ", " << n_insufficient << " with too few samples to "
+                  << "compare at alpha " << alpha;
+    std::cerr << std::endl;
+
+    return n_regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+}
@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Framework for native benchmarks.
+ *
+ * A benchmark is a class which declares its parameters and data (its
+ * fixture) and the phases to time. run_benchmark<Bench> handles argument
+ * parsing, thread setup, timing and output for it:
+ *
+ *     struct my_bench {
+ *         // Description shown in --help
+ *         static const char *description();
+ *         // CSV header of the benchmark's output
+ *         static const char *header();
+ *         // Add benchmark parameters to the command line parser
+ *         void add_args(CLI::App &app);
+ *         // Load or generate data, setting ctx.size. Returns false after
+ *         // printing an error if the data can't be used.
+ *         bool load(bench_context &ctx);
+ *         // Write the benchmark's parameter columns, each followed by ','
+ *         void write_meta(std::ostream &os);
+ *         // Time and report the phases (fit, predict, ...)
+ *         void run(bench_runner &runner);
+ *     };
+ *
+ * Phases are timed through bench_runner::time, which takes the timed
+ * functor as a template parameter, so the compiler sees the concrete type
+ * of the code being timed instead of calling it through std::function.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "npyfile.h"
+#include "results.hpp"
+#include "utilization.hpp"
+#include "profiler.hpp"
+#include "serving.hpp"
+
+
+/*
+ * Bookkeeping arguments and size of the data, which make up the first
+ * columns of every line of benchmark output.
+ */
+struct bench_context {
+    std::string batch;
+    std::string arch;
+    std::string prefix;
+    int num_threads;
+    bool header;
+    bool verbose;
+    int daal_threads;
+    std::string size;
+    std::string results_file;
+    std::string dataset;
+    bool roofline;
+    calibration_record calibration;
+    bool utilization;
+    bool profile;
+    int profile_top;
+};
+
+
+class bench_runner {
+
+    public:
+        bench_runner(const bench_context &ctx, const std::string &header,
+                     const std::string &meta_info, const std::string &params) :
+            ctx(ctx), header(header), meta_info(meta_info), params(params),
+            header_printed(false), work_flops(0.), work_bytes(0.) {
+
+            if (ctx.profile)
+                profiler.init(1000000);
+
+        }
+
+        bool verbose() const { return ctx.verbose; }
+
+        int threads() const { return ctx.daal_threads; }
+
+        /*
+         * Time the given functor with the given timing options,
+         * returning a pair of the minimum duration and the LAST result.
+         * All measured durations are kept for the results store. With
+         * --utilization, activity of TBB threads is monitored over all
+         * timed iterations. With --profile, they are sampled by the
+         * profiler as a phase named by the next report.
+         */
+        template <typename F>
+        std::pair<double, typename std::result_of<F()>::type>
+        time(F func, struct timing_options &opts) {
+
+            if (ctx.utilization)
+                monitor.start();
+            if (ctx.profile)
+                profiler.start();
+            auto pair = time_vec(func, opts.inner_loops, opts.outer_loops,
+                                 opts.time_limit, opts.goal_outer_loops,
+                                 ctx.verbose);
+            if (ctx.profile)
+                profiler.stop();
+            if (ctx.utilization)
+                utilization = monitor.stop();
+            samples.clear();
+            for (auto &t : pair.first)
+                samples.push_back(t.count());
+            double time = *std::min_element(samples.begin(), samples.end());
+
+            return std::make_pair(time, pair.second);
+
+        }
+
+        /*
+         * Set the analytic number of floating point operations and bytes
+         * of memory traffic of one call of the next reported function,
+         * for --roofline.
+         */
+        void work(double flops, double bytes) {
+
+            work_flops = flops;
+            work_bytes = bytes;
+
+        }
+
+        /*
+         * Output a line of results for the given function. Metrics are
+         * written between the function name and the time, in the order
+         * of the benchmark's header.
+         */
+        template <typename... Metrics>
+        void report(const std::string &function, double time,
+                    const Metrics &... metrics) {
+
+            if (ctx.header && !header_printed) {
+                std::cout << header << std::endl;
+                header_printed = true;
+            }
+
+            std::ostringstream line;
+            line << meta_info << function << ',';
+            write_metrics(line, metrics...);
+            line << time;
+            std::cout << line.str() << std::endl;
+
+            if (!ctx.results_file.empty())
+                store(function, time);
+            if (ctx.roofline)
+                report_roofline(function, time);
+            if (ctx.profile)
+                profiler.name_phase(function);
+            if (ctx.utilization && utilization.threads > 0)
+                print_utilization(function, utilization, ctx.verbose);
+            work_flops = work_bytes = 0.;
+            utilization.threads = 0;
+            samples.clear();
+
+        }
+
+        /*
+         * Output a line of results for a duration the benchmark measured
+         * itself rather than with time(), as the only sample of the phase.
+         */
+        template <typename... Metrics>
+        void report_measured(const std::string &function, double time,
+                             const Metrics &... metrics) {
+
+            samples.assign(1, time);
+            report(function, time, metrics...);
+
+        }
+
+        /*
+         * Output a line of results for a phase of calls the benchmark
+         * timed itself, storing the duration of each call as the samples
+         * of the phase.
+         */
+        template <typename... Metrics>
+        void report_samples(const std::string &function, double time,
+                            const std::vector<double> &durations,
+                            const Metrics &... metrics) {
+
+            samples = durations;
+            report(function, time, metrics...);
+
+        }
+
+        /*
+         * Simulate serving predict(table) on requests of rows of X at
+         * each offered load of --serve-qps (and micro-batch wait of
+         * --serve-max-wait), outputting a line of response time
+         * percentiles (in ms) for each.
+         */
+        template <typename Predict>
+        void serve(const std::string &function, Predict predict,
+                   dm::NumericTablePtr X_nt,
+                   const struct serving_options &opts) {
+
+            if (opts.qps.empty())
+                return;
+
+            trace_span span("serve", function);
+            size_t n_rows = X_nt->getNumberOfRows();
+            size_t n_cols = X_nt->getNumberOfColumns();
+            dm::BlockDescriptor<double> block;
+            X_nt->getBlockOfRows(0, n_rows, dm::readOnly, block);
+            const double *X = block.getBlockPtr();
+
+            // Untimed request, so one-time initialization isn't measured
+            predict(make_table((double *) X, std::min(opts.batch_size,
+                                                      n_rows), n_cols));
+
+            if (ctx.header && !serving_header_printed) {
+                std::cout << serving_header() << std::endl;
+                serving_header_printed = true;
+            }
+
+            size_t max_batch = std::max(opts.max_batch, opts.batch_size);
+            for (double max_wait : opts.max_wait) {
+                for (double qps : opts.qps) {
+                    serving_result r = serve_open_loop(predict, X, n_rows,
+                                                       n_cols, qps, max_wait,
+                                                       opts);
+                    std::cout << meta_info << function << ','
+                              << opts.batch_size << ',' << opts.workers << ','
+                              << max_batch << ',' << max_wait << ','
+                              << r.offered_qps << ',' << r.achieved_qps << ','
+                              << r.mean_batch_rows << ','
+                              << r.percentile(50) * 1e3 << ','
+                              << r.percentile(90) * 1e3 << ','
+                              << r.percentile(99) * 1e3 << ','
+                              << r.percentile(99.9) * 1e3 << ','
+                              << r.percentile(100) * 1e3 << std::endl;
+                    if (ctx.verbose) {
+                        std::cout << "@ " << function << ": " << r.n_requests
+                                  << " requests at " << qps << " QPS"
+                                  << std::endl;
+                    }
+                }
+            }
+
+            X_nt->releaseBlockOfRows(block);
+
+        }
+
+        /*
+         * Output hotspots of all phases sampled with --profile.
+         */
+        void report_profile() {
+
+            if (ctx.profile)
+                profiler.report(ctx.profile_top);
+
+        }
+
+    private:
+        const bench_context &ctx;
+        std::string header;
+        std::string meta_info;
+        std::string params;
+        bool header_printed;
+        bool serving_header_printed = false;
+        std::vector<double> samples;
+        double work_flops;
+        double work_bytes;
+        utilization_monitor monitor;
+        utilization_report utilization = utilization_report();
+        sampling_profiler profiler;
+
+        /*
+         * Output achieved throughput and bandwidth as a fraction of the
+         * calibrated peak of this host.
+         */
+        void report_roofline(const std::string &function, double time) {
+
+            if (work_flops <= 0. && work_bytes <= 0.)
+                return;
+
+            const calibration_record &peak = ctx.calibration;
+            std::cout << "@ " << function << " roofline:";
+            if (work_flops > 0.) {
+                double gflops = work_flops / time * 1e-9;
+                std::cout << ' ' << gflops << " GFLOP/s ("
+                          << 100. * gflops / peak.dgemm_gflops
+                          << "% of DGEMM peak)";
+            }
+            if (work_bytes > 0.) {
+                double gbs = work_bytes / time * 1e-9;
+                std::cout << (work_flops > 0. ? ", " : " ") << gbs
+                          << " GB/s (" << 100. * gbs / peak.triad_gbs
+                          << "% of STREAM triad)";
+            }
+            std::cout << std::endl;
+
+        }
+
+        /*
+         * Add the samples of the last timed phase to the results store.
+         * Reports without samples (not following time() or given by
+         * report_measured) aren't stored, as they can't be compared.
+         */
+        void store(const std::string &function, double time) {
+
+            if (samples.empty())
+                return;
+
+            static const host_info host = get_host_info();
+            daal::services::LibraryVersionInfo ver;
+            std::ostringstream version;
+            version << ver.majorVersion << '.' << ver.minorVersion << '.'
+                    << ver.updateVersion << '.' << ver.build;
+
+            result_record record;
+            record.batch = ctx.batch;
+            record.prefix = ctx.prefix;
+            record.function = function;
+            record.params = params;
+            record.size = ctx.size;
+            record.dataset = ctx.dataset;
+            record.threads = ctx.daal_threads;
+            record.host = host.fingerprint();
+            record.hostname = host.hostname;
+            record.cpu = host.cpu;
+            record.version = version.str();
+            record.time = time;
+            record.samples = samples;
+            append_record(ctx.results_file, record);
+
+        }
+
+        /*
+         * Header of serving results: the benchmark's columns up to the
+         * function, followed by serving parameters and percentiles.
+         */
+        std::string serving_header() const {
+
+            std::string lower(header);
+            std::transform(lower.begin(), lower.end(), lower.begin(),
+                           ::tolower);
+            size_t pos = lower.find(",function,");
+            std::string columns = pos == std::string::npos
+                ? "" : header.substr(0, pos + 10);
+            return columns + "batch_size,workers,max_batch,max_wait_us,"
+                "offered_qps,achieved_qps,mean_batch_rows,"
+                "p50_ms,p90_ms,p99_ms,p999_ms,max_ms";
+
+        }
+
+        void write_metrics(std::ostream &os) {}
+
+        template <typename T, typename... Rest>
+        void write_metrics(std::ostream &os, const T &metric,
+                           const Rest &... rest) {
+            os << metric << ',';
+            write_metrics(os, rest...);
+        }
+
+};
+
+
+/*
+ * Load an npy array with the given number of dimensions and numpy dtype
+ * (f8 for doubles, i8 for int64 labels), printing an error and returning
+ * NULL if we can't.
+ */
+struct npyarr *load_array(const std::string &fn, size_t dims,
+                          const std::string &label,
+                          const std::string &dtype = "f8") {
+
+    struct npyarr *arr = load_npy_cached(fn);
+    if (!arr) {
+        std::cerr << "Failed to load input array " << label << " from "
+            << fn << std::endl;
+        return NULL;
+    }
+    if (arr->shape_len != dims) {
+        std::cerr << "Expected " << dims
+            << (dims == 1 ? " dimension" : " dimensions") << " for "
+            << label << ", found " << arr->shape_len << std::endl;
+        return NULL;
+    }
+    if (!npy_has_dtype(arr, dtype)) {
+        std::cerr << "Expected dtype " << dtype << " for " << label
+            << ", found " << (arr->descr ? arr->descr : "none") << std::endl;
+        return NULL;
+    }
+
+    return arr;
+
+}
+
+
+/*
+ * Hash the contents of the npy files loaded for a benchmark, so that
+ * results on the same data can be matched up in the results store.
+ * Benchmarks which didn't load any files ran on random data, which is
+ * matched by size only.
+ */
+std::string dataset_hash(const std::vector<std::string> &files) {
+
+    static std::map<std::string, uint64_t> hashes;
+
+    std::vector<std::string> paths(files);
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    if (paths.empty())
+        return "random";
+
+    uint64_t hash = fnv1a(NULL, 0);
+    for (auto &path : paths) {
+        auto it = hashes.find(path);
+        if (it == hashes.end()) {
+            struct npyarr *arr = load_npy_cached(path);
+            size_t n_bytes = npy_elem_size(arr->descr);
+            for (size_t i = 0; i < arr->shape_len; i++)
+                n_bytes *= arr->shape[i];
+            uint64_t file_hash = fnv1a(arr->shape,
+                                       arr->shape_len * sizeof(size_t));
+            file_hash = fnv1a(arr->data, n_bytes, file_hash);
+            it = hashes.emplace(path, file_hash).first;
+        }
+        hash = fnv1a(&it->second, sizeof(uint64_t), hash);
+    }
+
+    return hex64(hash);
+
+}
+
+
+/*
+ * Run the benchmark Bench with the given command line arguments.
+ */
+template <typename Bench>
+int run_benchmark(int argc, char *argv[]) {
+
+    Bench bench;
+    CLI::App app(Bench::description());
+
+    bench_context ctx;
+    add_common_args(app, ctx.batch, ctx.arch, ctx.prefix, ctx.num_threads,
+                    ctx.header, ctx.verbose);
+    bench.add_args(app);
+
+    app.add_option("--store-results", ctx.results_file,
+                   "Append raw timing samples to this results store, for "
+                   "bench-compare (e.g. " DEFAULT_RESULTS_STORE ")");
+
+    ctx.roofline = false;
+    app.add_flag("--roofline", ctx.roofline,
+                 "Report throughput and bandwidth as a fraction of the "
+                 "peak measured by calibrate");
+
+    std::string calibration_file = DEFAULT_CALIBRATION_STORE;
+    app.add_option("--calibration", calibration_file,
+                   "Calibration store to read peaks from", true);
+
+    std::string trace_file;
+    app.add_option("--trace", trace_file,
+                   "Write a timeline of benchmark phases to this file in "
+                   "Chrome Trace Event format");
+
+    ctx.utilization = false;
+    app.add_flag("--utilization", ctx.utilization,
+                 "Report how busy TBB threads are in timed phases");
+
+    ctx.profile = false;
+    app.add_flag("--profile", ctx.profile,
+                 "Sample call stacks in timed phases and report hotspots");
+
+    ctx.profile_top = 10;
+    app.add_option("--profile-top", ctx.profile_top,
+                   "Number of functions to report per phase with --profile",
+                   true)->check(CLI::PositiveNumber);
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (!trace_file.empty())
+        tracing_enabled = true;
+
+    // Set DAAL thread count
+    ctx.daal_threads = set_threads(ctx.num_threads);
+
+    if (ctx.roofline && !find_calibration(calibration_file, ctx.daal_threads,
+                                          ctx.calibration)) {
+        std::cerr << "warning: no calibration of this host with "
+                  << ctx.daal_threads << " threads in " << calibration_file
+                  << ". Run calibrate -n " << ctx.daal_threads
+                  << " first." << std::endl;
+        ctx.roofline = false;
+    }
+
+    npy_files_used.clear();
+    {
+        trace_span span("load", Bench::description());
+        if (!bench.load(ctx))
+            return EXIT_FAILURE;
+    }
+    if (!ctx.results_file.empty())
+        ctx.dataset = dataset_hash(npy_files_used);
+
+    // Prepare meta-info
+    std::ostringstream params_stream;
+    bench.write_meta(params_stream);
+    std::string params = params_stream.str();
+
+    std::ostringstream meta_info_stream;
+    meta_info_stream
+        << ctx.batch << ','
+        << ctx.arch << ','
+        << ctx.prefix << ','
+        << ctx.daal_threads << ','
+        << ctx.size << ','
+        << params;
+
+    bench_runner runner(ctx, Bench::header(), meta_info_stream.str(),
+                        params);
+    {
+        trace_span span("run", Bench::description());
+        bench.run(runner);
+    }
+    runner.report_profile();
+
+    if (!trace_file.empty() && !write_trace(trace_file))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Measure the peak performance of this host and add it to the
+ * calibration store, for benchmarks run with --roofline.
+ */
+
+#include <string>
+#include <iostream>
+
+#include "CLI11.hpp"
+#include "calibrate.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    CLI::App app("Calibrate this host for roofline reports of native "
+                 "benchmarks");
+
+    int num_threads = 0;
+    app.add_option("-n,--num-threads", num_threads,
+                   "Number of threads to calibrate with. Should match the "
+                   "number of threads DAAL uses in benchmarks. Defaults to "
+                   "all available threads.");
+
+    std::string store = DEFAULT_CALIBRATION_STORE;
+    app.add_option("--calibration", store, "Calibration store to add to",
+                   true);
+
+    bool header = false;
+    app.add_flag("--header", header, "Output CSV header");
+
+    bool verbose = false;
+    app.add_flag("-v,--verbose", verbose, "Output extra debug messages");
+
+    struct calibration_options opts;
+    add_calibration_args(app, opts);
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (num_threads <= 0)
+        num_threads = tbb::this_task_arena::max_concurrency();
+
+    calibration_record r = calibrate(num_threads, opts, verbose);
+
+    if (header) {
+        std::cout << "hostname,cpu,threads,triad_gbs,dgemm_gflops,"
+                     "sgemm_gflops,latency_ns" << std::endl;
+    }
+    std::cout << r.hostname << ",\"" << r.cpu << "\"," << r.threads << ','
+              << r.triad_gbs << ',' << r.dgemm_gflops << ','
+              << r.sgemm_gflops << ',' << r.latency_ns << std::endl;
+
+    return append_record(store, r) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
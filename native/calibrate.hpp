@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Microbenchmarks measuring the peak performance of a host: STREAM triad
+ * bandwidth, MKL DGEMM/SGEMM throughput and memory latency. Benchmarks
+ * run with --roofline report their achieved bandwidth and throughput as
+ * a fraction of these.
+ */
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iostream>
+
+#include "CLI11.hpp"
+#include "tbb/task_arena.h"
+#include "tbb/parallel_for.h"
+#include "tbb/partitioner.h"
+#include "mkl.h"
+
+#include "results.hpp"
+
+
+/*
+ * Time the given function, returning the best time in seconds.
+ */
+template <typename F>
+double best_time(F func, int reps) {
+
+    double best = 0.;
+    for (int i = 0; i < reps; i++) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        func();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double t = std::chrono::duration<double>(t1 - t0).count();
+        if (i == 0 || t < best)
+            best = t;
+    }
+    return best;
+
+}
+
+
+/*
+ * Measure STREAM triad (a = b + s * c) bandwidth in GB/s over arrays of
+ * n doubles, which should be much larger than the last level cache.
+ * Arrays are initialized with the same static partitioning as the
+ * measured loop, so that pages are local to the threads using them.
+ */
+double measure_triad_bandwidth(size_t n, int reps) {
+
+    double *a = new double[n], *b = new double[n], *c = new double[n];
+    tbb::static_partitioner partitioner;
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n),
+        [=](const tbb::blocked_range<size_t> &r) {
+            for (size_t i = r.begin(); i < r.end(); i++) {
+                a[i] = 0.;
+                b[i] = 1.;
+                c[i] = 2.;
+            }
+        }, partitioner);
+
+    const double s = 3.;
+    double time = best_time([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, n),
+            [=](const tbb::blocked_range<size_t> &r) {
+                for (size_t i = r.begin(); i < r.end(); i++)
+                    a[i] = b[i] + s * c[i];
+            }, partitioner);
+    }, reps);
+
+    delete[] a;
+    delete[] b;
+    delete[] c;
+
+    return 3. * sizeof(double) * n / time * 1e-9;
+
+}
+
+
+void gemm(const double *a, const double *b, double *c, MKL_INT n) {
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, n, n,
+                1., a, n, b, n, 0., c, n);
+}
+
+
+void gemm(const float *a, const float *b, float *c, MKL_INT n) {
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, n, n,
+                1.f, a, n, b, n, 0.f, c, n);
+}
+
+
+/*
+ * Measure GEMM throughput in GFLOP/s with n x n matrices.
+ */
+template <typename T>
+double measure_gemm_throughput(size_t n, int reps) {
+
+    std::vector<T> a(n * n, (T) 1.), b(n * n, (T) 0.5), c(n * n);
+
+    // One untimed call, so MKL initialization isn't measured
+    gemm(a.data(), b.data(), c.data(), n);
+    double time = best_time([&] {
+        gemm(a.data(), b.data(), c.data(), n);
+    }, reps);
+
+    return 2. * n * n * n / time * 1e-9;
+
+}
+
+
+/*
+ * Measure latency in ns of dependent loads from a buffer of the given
+ * size, by following a random cycle of indices through it (Sattolo's
+ * algorithm), so that the hardware prefetchers can't help.
+ */
+double measure_latency(size_t bytes, size_t loads) {
+
+    size_t n = bytes / sizeof(size_t);
+    std::vector<size_t> next(n);
+    for (size_t i = 0; i < n; i++)
+        next[i] = i;
+
+    std::mt19937_64 rng(777);
+    for (size_t i = n - 1; i > 0; i--) {
+        std::uniform_int_distribution<size_t> dist(0, i - 1);
+        std::swap(next[i], next[dist(rng)]);
+    }
+
+    volatile size_t sink;
+    size_t j = 0;
+    double time = best_time([&] {
+        for (size_t i = 0; i < loads; i++)
+            j = next[j];
+        sink = j;
+    }, 3);
+    (void) sink;
+
+    return time / loads * 1e9;
+
+}
+
+
+struct calibration_options {
+    size_t stream_size; // Number of doubles in each STREAM array
+    size_t gemm_size;   // Matrix size for GEMM
+    size_t latency_bytes; // Buffer size for the latency test
+    int reps;
+};
+
+
+/*
+ * Calibrate this host with the given number of threads.
+ */
+calibration_record calibrate(int threads, const calibration_options &opts,
+                             bool verbose) {
+
+    host_info host = get_host_info();
+    calibration_record r;
+    r.host = host.fingerprint();
+    r.hostname = host.hostname;
+    r.cpu = host.cpu;
+    r.threads = threads;
+
+    mkl_set_num_threads(threads);
+    tbb::task_arena arena(threads);
+    arena.execute([&] {
+        r.triad_gbs = measure_triad_bandwidth(opts.stream_size, opts.reps);
+        if (verbose)
+            std::cout << "@ STREAM triad: " << r.triad_gbs << " GB/s"
+                      << std::endl;
+
+        r.dgemm_gflops = measure_gemm_throughput<double>(opts.gemm_size,
+                                                         opts.reps);
+        if (verbose)
+            std::cout << "@ DGEMM: " << r.dgemm_gflops << " GFLOP/s"
+                      << std::endl;
+
+        r.sgemm_gflops = measure_gemm_throughput<float>(opts.gemm_size,
+                                                        opts.reps);
+        if (verbose)
+            std::cout << "@ SGEMM: " << r.sgemm_gflops << " GFLOP/s"
+                      << std::endl;
+    });
+
+    r.latency_ns = measure_latency(opts.latency_bytes, 1 << 22);
+    if (verbose)
+        std::cout << "@ Latency: " << r.latency_ns << " ns" << std::endl;
+
+    return r;
+
+}
+
+
+void add_calibration_args(CLI::App &app, struct calibration_options &opts) {
+
+    opts.stream_size = 1 << 25;
+    app.add_option("--stream-size", opts.stream_size,
+                   "Number of doubles in each STREAM triad array", true);
+
+    opts.gemm_size = 4096;
+    app.add_option("--gemm-size", opts.gemm_size,
+                   "Size of matrices for DGEMM and SGEMM", true);
+
+    opts.latency_bytes = 1 << 28;
+    app.add_option("--latency-bytes", opts.latency_bytes,
+                   "Buffer size for the memory latency test", true);
+
+    opts.reps = 5;
+    app.add_option("--calibration-reps", opts.reps,
+                   "Repetitions of each calibration test", true);
+
+}
@@ -1,18 +1,171 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <iostream>
+#include <fstream>
 #include <chrono>
+#include <type_traits>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
 
 #include "CLI11.hpp"
 #include "daal.h"
+#include "json.hpp"
 #include "npyfile.h"
 
 namespace dm = daal::data_management;
 namespace ds = daal::services;
 namespace da = daal::algorithms;
 
+/*
+ * Set by the multi-benchmark driver (bench.cpp) so that parameters from the
+ * shared JSON config which a given benchmark does not know about (e.g.
+ * data-format) are ignored instead of rejected.
+ */
+static bool allow_extra_args = false;
+
+
+/*
+ * Tracing of benchmark phases as a timeline in Chrome Trace Event JSON,
+ * which can be opened in Perfetto or chrome://tracing.
+ *
+ * A trace_span records the time between its construction and destruction
+ * in a buffer belonging to the current thread, so recording takes no
+ * locks (a lock is only taken the first time a thread records a span).
+ * While tracing is disabled, spans only cost a relaxed atomic load.
+ * Recording still costs clock reads and a push_back, so spans are only
+ * opened outside timed regions: around runner.time() calls, never in the
+ * functions they time.
+ */
+struct trace_event {
+    const char *name;
+    std::string detail;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+struct trace_buffer {
+    long tid;
+    std::vector<trace_event> events;
+};
+
+static std::atomic<bool> tracing_enabled(false);
+static std::mutex trace_buffers_mutex;
+static std::vector<std::unique_ptr<trace_buffer>> trace_buffers;
+
+
+uint64_t trace_now_ns() {
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
+
+
+trace_buffer *this_thread_trace_buffer() {
+
+    thread_local trace_buffer *buffer = NULL;
+    if (!buffer) {
+        std::unique_ptr<trace_buffer> new_buffer(new trace_buffer);
+        new_buffer->tid = syscall(SYS_gettid);
+        buffer = new_buffer.get();
+
+        std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+        trace_buffers.push_back(std::move(new_buffer));
+    }
+    return buffer;
+
+}
+
+
+class trace_span {
+
+    public:
+        trace_span(const char *name) :
+            active(tracing_enabled.load(std::memory_order_relaxed)),
+            name(name) {
+            if (active)
+                begin_ns = trace_now_ns();
+        }
+
+        trace_span(const char *name, const std::string &detail) :
+            trace_span(name) {
+            if (active)
+                this->detail = detail;
+        }
+
+        ~trace_span() {
+            if (active) {
+                this_thread_trace_buffer()->events.push_back(
+                        {name, detail, begin_ns, trace_now_ns()});
+            }
+        }
+
+    private:
+        bool active;
+        const char *name;
+        std::string detail;
+        uint64_t begin_ns;
+
+};
+
+
+/*
+ * Write all recorded spans to a Chrome Trace Event JSON file. This must
+ * only be called when no spans are being recorded, e.g. after the
+ * benchmarks have run. Returns false after printing an error on failure.
+ */
+bool write_trace(const std::string &path) {
+
+    std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+
+    uint64_t origin_ns = UINT64_MAX;
+    for (auto &buffer : trace_buffers)
+        for (auto &event : buffer->events)
+            origin_ns = std::min(origin_ns, event.begin_ns);
+
+    std::ofstream f(path);
+    f << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    char times[64];
+    for (auto &buffer : trace_buffers) {
+        for (auto &event : buffer->events) {
+            // Timestamps are in microseconds
+            snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f",
+                     (event.begin_ns - origin_ns) / 1e3,
+                     (event.end_ns - event.begin_ns) / 1e3);
+            f << (first ? "\n" : ",\n")
+              << "{\"name\": " << json_quote(event.name)
+              << ", \"ph\": \"X\", " << times
+              << ", \"pid\": " << getpid()
+              << ", \"tid\": " << buffer->tid;
+            if (!event.detail.empty())
+                f << ", \"args\": {\"detail\": " << json_quote(event.detail)
+                  << '}';
+            f << '}';
+            first = false;
+        }
+    }
+    f << "\n]}" << std::endl;
+
+    if (!f) {
+        std::cerr << "error: failed to write trace to " << path << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+
 struct timing_options {
     int inner_loops; // Maximum number of inner loops
     int outer_loops; // Maximum number of outer loops
@@ -120,19 +273,73 @@ int set_threads(int num_threads) {
 }
 
 
+/*
+ * Resident set size of this process in bytes, current (VmRSS) or peak
+ * (VmHWM), from /proc/self/status. Returns 0 if it can't be read.
+ */
+size_t read_rss(const std::string &field = "VmRSS") {
+
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+            return std::stoull(line.substr(field.size() + 1)) * 1024;
+    }
+    return 0;
+
+}
+
+
+size_t read_peak_rss() {
+    return read_rss("VmHWM");
+}
+
+
+/*
+ * Reset the peak RSS of this process to its current RSS, so the next
+ * read_peak_rss() covers only what runs in between. Returns false if
+ * the kernel doesn't support it, in which case the peak is that of the
+ * whole process.
+ */
+bool reset_peak_rss() {
+
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5" << std::endl;
+    return clear_refs.good();
+
+}
+
+
+/*
+ * User and system CPU time of all threads of this process, in seconds.
+ */
+double process_cpu_time() {
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+           + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+
+}
+
+
 /*
  * Time the given function for the specified number of repetitions,
  * returning a pair of a vector of durations and the LAST result.
+ *
+ * The function is a template parameter rather than a std::function so
+ * that calls to it can be inlined into the timing loop.
  */
-template <typename T>
-std::pair<std::vector<std::chrono::duration<double>>, T>
-time_vec(std::function<T()> func, int inner_loops, int outer_loops,
+template <typename F>
+std::pair<std::vector<std::chrono::duration<double>>,
+          typename std::result_of<F()>::type>
+time_vec(F func, int inner_loops, int outer_loops,
          double time_limit, int goal_outer_loops, bool verbose) {
 
     std::vector<std::chrono::duration<double>> vec;
     double total_time = 0.;
 
-    T result;
+    typename std::result_of<F()>::type result;
 
     // Execute warm-up iterations to determine optimal inner_loops
     bool warmup = (goal_outer_loops > 0);
@@ -141,6 +348,9 @@ time_vec(std::function<T()> func, int inner_loops, int outer_loops,
 
     if (warmup) {
         for (int i = 0; i < inner_loops; i++) {
+            // Trace spans are recorded outside the timed region, so that
+            // --trace doesn't add to the measured time
+            trace_span span("warmup iteration");
             auto t0 = std::chrono::high_resolution_clock::now();
             result = func();
             auto t1 = std::chrono::high_resolution_clock::now();
@@ -178,14 +388,16 @@ time_vec(std::function<T()> func, int inner_loops, int outer_loops,
         // Otherwise, actually take the timing
         for (int i = 0; i < outer_loops; i++) {
 
+            // One span of all inner loops, outside the timed region
             std::chrono::duration<double> delta;
-            auto t0 = std::chrono::high_resolution_clock::now();
-            for (int j = 0; j < inner_loops; j++) {
-                result = func();
+            {
+                trace_span span("iteration");
+                auto t0 = std::chrono::high_resolution_clock::now();
+                for (int j = 0; j < inner_loops; j++)
+                    result = func();
+                auto t1 = std::chrono::high_resolution_clock::now();
+                delta = t1 - t0;
             }
-            auto t1 = std::chrono::high_resolution_clock::now();
-
-            delta = t1 - t0;
 
             vec.push_back(delta / inner_loops);
             total_time += delta.count();
@@ -218,9 +430,9 @@ time_vec(std::function<T()> func, int inner_loops, int outer_loops,
  * Time the given function for the specified number of repetitions,
  * returning a pair of the minimum duration and the LAST result.
  */
-template <typename T>
-std::pair<double, T>
-time_min(std::function<T()> func, int inner_loops, int outer_loops,
+template <typename F>
+std::pair<double, typename std::result_of<F()>::type>
+time_min(F func, int inner_loops, int outer_loops,
          double time_limit, int goal_outer_loops, bool verbose) {
 
     auto pair = time_vec(func, inner_loops, outer_loops, time_limit,
@@ -237,9 +449,9 @@ time_min(std::function<T()> func, int inner_loops, int outer_loops,
  * Time the given function for the specified number of repetitions,
  * returning a pair of the minimum duration and the LAST result.
  */
-template <typename T>
-std::pair<double, T>
-time_min(std::function<T()> func, struct timing_options &o, bool verbose) {
+template <typename F>
+std::pair<double, typename std::result_of<F()>::type>
+time_min(F func, struct timing_options &o, bool verbose) {
 
     return time_min(func, o.inner_loops, o.outer_loops, o.time_limit,
                     o.goal_outer_loops, verbose);
@@ -247,6 +459,42 @@ time_min(std::function<T()> func, struct timing_options &o, bool verbose) {
 }
 
 
+/*
+ * Paths passed to load_npy_cached, so that the results store can tell
+ * which dataset a benchmark ran on. Cleared by run_benchmark.
+ */
+static std::vector<std::string> npy_files_used;
+
+
+/*
+ * Load an npy file, returning the array already loaded from the same path
+ * if there is one. If the file was preloaded into shared memory by dsload,
+ * it is mapped from there instead of read. Arrays returned from here are
+ * shared between all benchmarks run by this process and must not be
+ * modified or freed.
+ */
+struct npyarr *load_npy_cached(const std::string &path) {
+
+    static std::map<std::string, struct npyarr *> cache;
+
+    npy_files_used.push_back(path);
+
+    auto it = cache.find(path);
+    if (it != cache.end())
+        return it->second;
+
+    trace_span span("load_npy", path);
+
+    struct npyarr *arr = load_shared_npy(path.c_str());
+    if (!arr)
+        arr = load_npy(path.c_str());
+    if (arr)
+        cache[path] = arr;
+    return arr;
+
+}
+
+
 /*
  * Create a DAAL HomogenNumericTable from an array in memory.
  */
@@ -396,6 +644,85 @@ double *gen_random(size_t n) {
 }
 
 
+/*
+ * Whether the elements of an npy array are of the given numpy type, e.g.
+ * f8 for doubles or i8 for int64, in native (little-endian) byte order.
+ */
+bool npy_has_dtype(const struct npyarr *arr, const std::string &dtype) {
+
+    if (!arr->descr)
+        return false;
+    std::string descr(arr->descr);
+    if (!descr.empty()
+        && (descr[0] == '<' || descr[0] == '=' || descr[0] == '|'))
+        descr.erase(0, 1);
+    return descr == dtype;
+
+}
+
+
+/*
+ * Get the data for a benchmark which runs either on random data of a given
+ * size or on an array loaded from a file.
+ *
+ * Parameters
+ * ----------
+ * fn : std::string
+ *     File to load. If empty, generate random data of size string_size.
+ * size : std::vector<int> &
+ *     Vector to which we should output the size of the data
+ * string_size : std::string &
+ *     Size of random data to generate. If a file is loaded, this is
+ *     replaced with the shape of the loaded array.
+ *
+ * Returns
+ * -------
+ * double *
+ *     Row-major data. 1D arrays are treated as a single column. NULL,
+ *     after printing an error, if the file can't be loaded or isn't a
+ *     1D or 2D array of doubles.
+ */
+double *load_or_gen_random(const std::string &fn, std::vector<int> &size,
+                           std::string &string_size) {
+
+    size.clear();
+
+    if (fn.empty()) {
+        parse_size(string_size, size);
+        check_dims(size, 2);
+        return gen_random(size[0] * size[1]);
+    }
+
+    struct npyarr *arr = load_npy_cached(fn);
+    if (!arr) {
+        std::cerr << "error: failed to load " << fn << std::endl;
+        return NULL;
+    }
+    if (!npy_has_dtype(arr, "f8")) {
+        std::cerr << "error: " << fn << " has dtype "
+                  << (arr->descr ? arr->descr : "none")
+                  << " but float64 is needed" << std::endl;
+        return NULL;
+    }
+
+    size.assign(arr->shape, arr->shape + arr->shape_len);
+    if (size.size() == 1)
+        size.push_back(1);
+    if (size.size() != 2) {
+        std::cerr << "error: " << fn << " has " << size.size()
+                  << " dimensions but 1 or 2 are needed" << std::endl;
+        return NULL;
+    }
+
+    std::ostringstream string_size_stream;
+    string_size_stream << size[0] << 'x' << size[1];
+    string_size = string_size_stream.str();
+
+    return (double *) arr->data;
+
+}
+
+
 /*
  * Print the given numeric table (for diagnostic purposes)
  */
@@ -451,6 +778,8 @@ void add_common_args(CLI::App &app,
     verbose = false;
     app.add_flag("-v,--verbose", verbose, "Output extra debug messages");
 
+    app.allow_extras(allow_extra_args);
+
 }
 
 
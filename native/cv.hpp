@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * K-fold cross-validation of supervised benchmarks with --cv-folds.
+ *
+ * Folds are contiguous ranges of rows, so the test rows of a fold are a
+ * table sharing the memory of the data and its training rows are a
+ * RowMergedNumericTable of the rows before and after them, without
+ * copying anything (--cv-gather copies them into contiguous tables
+ * instead, inside the timed region). Rows should be in random order, as
+ * they are in generated datasets.
+ *
+ * Cross-validation is timed with folds run one after another with all
+ * threads, and concurrently in streams, each with a tbb::task_arena of
+ * an equal share of the threads, as fold fits often don't scale to all
+ * threads. Which is faster depends on the algorithm, so both are
+ * reported.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <iostream>
+#include <algorithm>
+
+#include "tbb/task_arena.h"
+
+#include "daal.h"
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+
+namespace dm = daal::data_management;
+namespace ds = daal::services;
+
+
+struct cv_options {
+    int folds;                    // 0 to not cross-validate
+    bool gather;                  // Copy folds into contiguous tables
+    struct timing_options timing;
+};
+
+
+void add_cv_args(CLI::App &app, struct cv_options &opts) {
+
+    opts.folds = 0;
+    app.add_option("--cv-folds", opts.folds,
+                   "Also time K-fold cross-validation, with folds run one "
+                   "after another with all threads and concurrently with "
+                   "a share of the threads each (0: no cross-validation)",
+                   true);
+
+    opts.gather = false;
+    app.add_flag("--cv-gather", opts.gather,
+                 "Copy the rows of each fold into contiguous tables "
+                 "instead of using views of the data");
+
+    // Each repetition fits K models, so only a few are timed, but at
+    // least 5 so that bench-compare can find changes significant
+    opts.timing = {1, 5, 120., 0};
+    add_timing_args(app, "cv", opts.timing);
+
+}
+
+
+bool check_cv_options(const struct cv_options &opts, size_t n_rows) {
+
+    if (opts.folds == 0)
+        return true;
+    if (opts.folds < 2 || (size_t) opts.folds > n_rows) {
+        std::cerr << "error: --cv-folds must be between 2 and the number "
+                  << "of rows (" << n_rows << ')' << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+
+template <typename T>
+dm::NumericTablePtr homogen_rows(dm::NumericTablePtr table, size_t begin,
+                                 size_t end) {
+
+    auto homogen = ds::dynamicPointerCast<dm::HomogenNumericTable<T>,
+                                          dm::NumericTable>(table);
+    if (!homogen)
+        return dm::NumericTablePtr();
+    size_t cols = table->getNumberOfColumns();
+    return make_table(homogen->getArray() + begin * cols, end - begin,
+                      cols);
+
+}
+
+
+/*
+ * Rows [begin, end) of a table, sharing its memory if it is a
+ * HomogenNumericTable, or else (or if gather) copied as doubles.
+ */
+dm::NumericTablePtr table_rows(dm::NumericTablePtr table, size_t begin,
+                               size_t end, bool gather) {
+
+    dm::NumericTablePtr rows;
+    if (!gather) {
+        rows = homogen_rows<double>(table, begin, end);
+        if (!rows)
+            rows = homogen_rows<int64_t>(table, begin, end);
+        if (!rows)
+            rows = homogen_rows<int>(table, begin, end);
+        if (rows)
+            return rows;
+    }
+
+    size_t cols = table->getNumberOfColumns();
+    auto copy = dm::HomogenNumericTable<double>::create(
+            cols, end - begin, dm::NumericTable::doAllocate);
+    dm::BlockDescriptor<double> block;
+    table->getBlockOfRows(begin, end - begin, dm::readOnly, block);
+    std::copy(block.getBlockPtr(), block.getBlockPtr() + (end - begin) * cols,
+              copy->getArray());
+    table->releaseBlockOfRows(block);
+    return copy;
+
+}
+
+
+/*
+ * All rows of a table except [begin, end): a view of the rows before and
+ * after them, or a copy if gather.
+ */
+dm::NumericTablePtr table_rows_except(dm::NumericTablePtr table,
+                                      size_t begin, size_t end,
+                                      bool gather) {
+
+    size_t n_rows = table->getNumberOfRows();
+    if (begin == 0)
+        return table_rows(table, end, n_rows, gather);
+    if (end == n_rows)
+        return table_rows(table, 0, begin, gather);
+
+    if (gather) {
+        size_t cols = table->getNumberOfColumns();
+        auto copy = dm::HomogenNumericTable<double>::create(
+                cols, n_rows - (end - begin), dm::NumericTable::doAllocate);
+        dm::BlockDescriptor<double> block;
+        table->getBlockOfRows(0, n_rows, dm::readOnly, block);
+        const double *data = block.getBlockPtr();
+        double *dest = std::copy(data, data + begin * cols, copy->getArray());
+        std::copy(data + end * cols, data + n_rows * cols, dest);
+        table->releaseBlockOfRows(block);
+        return copy;
+    }
+
+    auto merged = dm::RowMergedNumericTable::create();
+    merged->addNumericTable(table_rows(table, 0, begin, false));
+    merged->addNumericTable(table_rows(table, end, n_rows, false));
+    return merged;
+
+}
+
+
+/*
+ * Fit on all folds but one and score on that one with
+ * fit_score(X_train, Y_train, X_test, Y_test).
+ */
+template <typename FitScore>
+double cv_fold(dm::NumericTablePtr X_nt, dm::NumericTablePtr Y_nt,
+               int fold, const struct cv_options &opts,
+               FitScore fit_score) {
+
+    size_t n_rows = X_nt->getNumberOfRows();
+    size_t begin = n_rows * fold / opts.folds;
+    size_t end = n_rows * (fold + 1) / opts.folds;
+
+    return fit_score(table_rows_except(X_nt, begin, end, opts.gather),
+                     table_rows_except(Y_nt, begin, end, opts.gather),
+                     table_rows(X_nt, begin, end, opts.gather),
+                     table_rows(Y_nt, begin, end, opts.gather));
+
+}
+
+
+/*
+ * Scores of all folds, run one after another with all threads.
+ */
+template <typename FitScore>
+std::vector<double> cv_sequential(dm::NumericTablePtr X_nt,
+                                  dm::NumericTablePtr Y_nt,
+                                  const struct cv_options &opts,
+                                  FitScore fit_score) {
+
+    std::vector<double> scores(opts.folds);
+    for (int fold = 0; fold < opts.folds; fold++)
+        scores[fold] = cv_fold(X_nt, Y_nt, fold, opts, fit_score);
+    return scores;
+
+}
+
+
+/*
+ * Scores of all folds, run concurrently in min(K, n_threads) streams of
+ * n_threads / streams threads, each taking the next fold when done. If a
+ * fold throws (e.g. when its training rows miss a class), the other
+ * streams stop taking folds and the exception is rethrown here.
+ */
+template <typename FitScore>
+std::vector<double> cv_concurrent(dm::NumericTablePtr X_nt,
+                                  dm::NumericTablePtr Y_nt,
+                                  const struct cv_options &opts,
+                                  int n_threads, FitScore fit_score) {
+
+    int n_streams = std::max(std::min(opts.folds, n_threads), 1);
+    int stream_threads = std::max(n_threads / n_streams, 1);
+    std::vector<double> scores(opts.folds);
+    std::atomic<int> next_fold(0);
+    std::vector<std::exception_ptr> errors(n_streams);
+
+    std::vector<std::thread> streams;
+    for (int i = 0; i < n_streams; i++) {
+        streams.emplace_back([&, i] {
+            tbb::task_arena arena(stream_threads);
+            for (int fold = next_fold++; fold < opts.folds;
+                 fold = next_fold++) {
+                try {
+                    arena.execute([&] {
+                        scores[fold] = cv_fold(X_nt, Y_nt, fold, opts,
+                                               fit_score);
+                    });
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                    next_fold = opts.folds;
+                }
+            }
+        });
+    }
+    for (auto &stream : streams)
+        stream.join();
+    for (auto &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    return scores;
+
+}
+
+
+double mean_score(const std::vector<double> &scores) {
+
+    return std::accumulate(scores.begin(), scores.end(), 0.)
+           / scores.size();
+
+}
+
+
+void print_cv_scores(const std::string &function,
+                     const std::vector<double> &scores) {
+
+    double mean = mean_score(scores), var = 0.;
+    for (double s : scores)
+        var += (s - mean) * (s - mean);
+    std::cout << "@ " << function << ": fold scores";
+    for (double s : scores)
+        std::cout << ' ' << s;
+    std::cout << ", mean " << mean << " +- "
+              << std::sqrt(var / scores.size()) << std::endl;
+
+}
+
+
+/*
+ * Time --cv-folds cross-validation of fit_score with both strategies,
+ * calling report(function, time, mean score) for each. Functions are
+ * prefix.cv_sequential and prefix.cv_concurrent, suffixed with .gather
+ * for --cv-gather and with suffix.
+ */
+template <typename FitScore, typename Report>
+void run_cv(bench_runner &runner, const std::string &prefix,
+            dm::NumericTablePtr X_nt, dm::NumericTablePtr Y_nt,
+            struct cv_options &opts, FitScore fit_score, Report report,
+            const std::string &suffix = "") {
+
+    if (opts.folds == 0)
+        return;
+
+    std::string layout = opts.gather ? ".gather" : "";
+    std::string seq_name = prefix + ".cv_sequential" + layout + suffix;
+    std::string conc_name = prefix + ".cv_concurrent" + layout + suffix;
+
+    double seq_time, conc_time;
+    std::vector<double> scores;
+    {
+        trace_span span("cv_sequential", seq_name);
+        std::tie(seq_time, scores) = runner.time([&] {
+                return cv_sequential(X_nt, Y_nt, opts, fit_score);
+            }, opts.timing);
+    }
+    if (runner.verbose())
+        print_cv_scores(seq_name, scores);
+    report(seq_name, seq_time, mean_score(scores));
+
+    {
+        trace_span span("cv_concurrent", conc_name);
+        std::tie(conc_time, scores) = runner.time([&] {
+                return cv_concurrent(X_nt, Y_nt, opts, runner.threads(),
+                                     fit_score);
+            }, opts.timing);
+    }
+    if (runner.verbose()) {
+        print_cv_scores(conc_name, scores);
+        std::cout << "@ " << prefix << ".cv" << layout << suffix
+                  << ": concurrent "
+                  << "folds " << seq_time / conc_time << "x the speed of "
+                  << "sequential folds" << std::endl;
+    }
+    report(conc_name, conc_time, mean_score(scores));
+
+}
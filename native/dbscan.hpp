@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <chrono>  
+
+#define DAAL_DATA_TYPE double
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "CLI11.hpp"
+#include "daal.h"
+#include "npyfile.h"
+
+
+da::dbscan::ResultPtr
+dbscan_test(dm::NumericTablePtr X_nt, double eps, int min_samples) {
+
+    da::dbscan::Batch<double> algorithm(eps, min_samples);
+    algorithm.input.set(da::dbscan::data, X_nt);
+    algorithm.compute();
+
+    return algorithm.getResult();
+
+}
+
+
+struct dbscan_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL DBSCAN clustering";
+    }
+
+    static const char *header() {
+        return "Batch,Arch,Prefix,Threads,Size,Function,Clusters,Time";
+    }
+
+    struct timing_options timing_opts = {100, 100, 10., 10};
+    std::string filex;
+    double eps = 10.;
+    int min_samples = 5;
+
+    dm::NumericTablePtr X_nt;
+
+    void add_args(CLI::App &app) {
+
+        add_timing_args(app, "", timing_opts);
+
+        app.add_option("-x,--filex,--fileX,--file-X-train", filex,
+                       "Feature file name")
+            ->required()->check(CLI::ExistingFile);
+
+        app.add_option("-e,--eps,--epsilon", eps,
+                       "Radius of neighborhood of a point");
+
+        app.add_option("-m,--min-samples", min_samples,
+                       "The minimum number of samples required in a "
+                       "neighborhood to consider a point a core point");
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        struct npyarr *arrX = load_array(filex, 2, "X");
+        if (!arrX)
+            return false;
+
+        // Infer data size from loaded arrays
+        std::ostringstream stringSizeStream;
+        stringSizeStream << arrX->shape[0] << 'x' << arrX->shape[1];
+        ctx.size = stringSizeStream.str();
+
+        // Create numeric tables from input data
+        trace_span span("make_table");
+        X_nt = make_table((double *) arrX->data,
+                          arrX->shape[0], arrX->shape[1]);
+
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {}
+
+    void run(bench_runner &runner) {
+
+        double time;
+        da::dbscan::ResultPtr dbscan_result;
+        std::tie(time, dbscan_result) = runner.time([&] {
+                    return dbscan_test(X_nt, eps, min_samples);
+                }, timing_opts);
+
+        // Get number of clusters found
+        dm::NumericTablePtr n_clusters_nt
+            = dbscan_result->get(da::dbscan::nClusters);
+        dm::BlockDescriptor<int> n_clusters_block;
+        n_clusters_nt->getBlockOfRows(0, 1, dm::readOnly, n_clusters_block);
+        int n_clusters = n_clusters_block.getBlockPtr()[0];
+        n_clusters_nt->releaseBlockOfRows(n_clusters_block);
+
+        runner.report("DBSCAN", time, n_clusters);
+
+    }
+
+};
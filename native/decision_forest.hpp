@@ -0,0 +1,763 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Parameters and data preparation shared by the decision forest
+ * classification and regression benchmarks.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/blocked_range2d.h"
+
+#include "daal.h"
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+
+namespace dm = daal::data_management;
+namespace ds = daal::services;
+namespace da = daal::algorithms;
+namespace df = daal::algorithms::decision_forest;
+namespace dtu = daal::algorithms::tree_utils;
+
+
+struct df_params {
+    size_t n_trees;
+    size_t seed;
+    size_t features_per_node;  // 0 for all features
+    size_t max_depth;          // 0 for unlimited depth
+    double min_impurity;
+    bool bootstrap;
+    std::string method;        // defaultDense or hist
+    size_t max_bins;           // Bins per feature for hist and binning
+    bool native_binning;       // Train on our own quantile bins of X
+    std::string var_importance; // none, MDI, MDA_Raw or MDA_Scaled
+    std::string oob;           // OOB results: none, error, per-observation
+                               // or all
+    // Combinations of the above to train with, timing each
+    std::vector<std::string> var_importance_sweep;
+    std::vector<std::string> oob_sweep;
+    size_t min_leaf;           // Minimal observations in a leaf
+    size_t max_leaf_nodes;     // 0 for unlimited leaves
+    // Models of each combination of the above are trained and evaluated
+    std::vector<size_t> min_leaf_sweep;
+    std::vector<size_t> max_leaf_nodes_sweep;
+    bool model_size;           // Report the size of trained models
+    std::string engine;        // mt2203, mt19937 or mcg59
+    double samples_fraction;   // Observations sampled for each tree
+    bool compare_bootstrap;    // Also train without bootstrap, timing both
+    size_t tree_times;         // Single-tree forests to time, 0 for none
+};
+
+
+void add_df_args(CLI::App &app, struct df_params &params) {
+
+    params.n_trees = 100;
+    app.add_option("--num-trees", params.n_trees,
+                   "Number of trees in decision forest", true);
+
+    params.features_per_node = 0;
+    app.add_option("--features-per-node", params.features_per_node,
+                   "Number of features per node", true);
+
+    params.max_depth = 0;
+    app.add_option("--max-depth", params.max_depth,
+                   "Maximal depth of trees in the forest. "
+                   "Zero means depth is not limited.", true);
+
+    params.seed = 12345;
+    app.add_option("--seed", params.seed, "Seed for the --engine RNG", true);
+
+    params.min_impurity = 0.;
+    params.bootstrap = true;
+
+    params.method = "defaultDense";
+    app.add_option("--method", params.method,
+                   "Training method: defaultDense on raw features, or hist "
+                   "on features binned by DAAL", true)
+        ->check(CLI::IsMember({"defaultDense", "hist"}));
+
+    params.max_bins = 256;
+    app.add_option("--max-bins", params.max_bins,
+                   "Maximal number of bins per feature for the hist method "
+                   "and --native-binning", true)
+        ->check(CLI::Range(2, 65536));
+
+    params.native_binning = false;
+    app.add_flag("--native-binning", params.native_binning,
+                 "Bin features into quantiles ourselves before training, "
+                 "and train and predict on the bin matrix");
+
+    params.var_importance_sweep = {"MDI"};
+    app.add_option("--var-importance", params.var_importance_sweep,
+                   "Variable importance to compute. With several modes "
+                   "(or --oob results), training is timed for each "
+                   "combination.", true)
+        ->check(CLI::IsMember({"none", "MDI", "MDA_Raw", "MDA_Scaled"}));
+
+    params.oob_sweep = {"none"};
+    app.add_option("--oob", params.oob_sweep,
+                   "Out-of-bag results to compute: the error, the error "
+                   "per observation, or all", true)
+        ->check(CLI::IsMember({"none", "error", "per-observation", "all"}));
+
+    params.min_leaf_sweep = {1};
+    app.add_option("--min-leaf", params.min_leaf_sweep,
+                   "Minimal number of observations in a leaf. With several "
+                   "values (or --max-leaf-nodes), a model is trained and "
+                   "evaluated for each combination.", true)
+        ->check(CLI::PositiveNumber);
+
+    params.max_leaf_nodes_sweep = {0};
+    app.add_option("--max-leaf-nodes", params.max_leaf_nodes_sweep,
+                   "Maximal number of leaves in a tree. Zero means the "
+                   "number of leaves is not limited.", true);
+
+    params.model_size = false;
+    app.add_flag("--model-size", params.model_size,
+                 "Report the nodes, leaves and depths of the trees of "
+                 "trained models, their serialized size and the peak RSS "
+                 "of training");
+
+    params.engine = "mt2203";
+    app.add_option("--engine", params.engine,
+                   "Random number engine sampling observations and "
+                   "features", true)
+        ->check(CLI::IsMember({"mt2203", "mt19937", "mcg59"}));
+
+    params.samples_fraction = 1.;
+    app.add_option("--samples-fraction", params.samples_fraction,
+                   "Fraction of observations sampled for each tree", true)
+        ->check(CLI::Range(0., 1.));
+
+    params.compare_bootstrap = false;
+    app.add_flag("--compare-bootstrap", params.compare_bootstrap,
+                 "Also time training without bootstrap");
+
+    params.tree_times = 0;
+    app.add_option("--tree-times", params.tree_times,
+                   "Time training this many single-tree forests one at a "
+                   "time, and the sampling of their observations, to show "
+                   "the distribution of time per tree", true);
+
+    params.var_importance = params.var_importance_sweep[0];
+    params.oob = params.oob_sweep[0];
+    params.min_leaf = params.min_leaf_sweep[0];
+    params.max_leaf_nodes = params.max_leaf_nodes_sweep[0];
+
+}
+
+
+/*
+ * Check the parameters after parsing, choosing the first combination of
+ * diagnostics.
+ */
+bool check_df_params(struct df_params &params) {
+
+    params.var_importance = params.var_importance_sweep[0];
+    params.oob = params.oob_sweep[0];
+    params.min_leaf = params.min_leaf_sweep[0];
+    params.max_leaf_nodes = params.max_leaf_nodes_sweep[0];
+    if (params.samples_fraction <= 0.) {
+        std::cerr << "error: --samples-fraction must be positive"
+                  << std::endl;
+        return false;
+    }
+    if (params.bootstrap)
+        return true;
+
+    // Both OOB results and permutation importance are computed on the
+    // observations left out of each tree's bootstrap sample
+    for (auto &mode : params.var_importance_sweep) {
+        if (mode.compare(0, 3, "MDA") == 0) {
+            std::cerr << "error: --var-importance " << mode
+                      << " needs bootstrap" << std::endl;
+            return false;
+        }
+    }
+    for (auto &oob : params.oob_sweep) {
+        if (oob != "none") {
+            std::cerr << "error: --oob " << oob << " needs bootstrap"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+
+}
+
+
+df::training::VariableImportanceMode
+df_var_importance(const std::string &mode) {
+
+    if (mode == "MDI")
+        return df::training::MDI;
+    if (mode == "MDA_Raw")
+        return df::training::MDA_Raw;
+    if (mode == "MDA_Scaled")
+        return df::training::MDA_Scaled;
+    return df::training::none;
+
+}
+
+
+DAAL_UINT64 df_results_to_compute(const std::string &oob) {
+
+    if (oob == "error")
+        return df::training::computeOutOfBagError;
+    if (oob == "per-observation")
+        return df::training::computeOutOfBagErrorPerObservation;
+    if (oob == "all")
+        return df::training::computeOutOfBagError
+            | df::training::computeOutOfBagErrorPerObservation;
+    return 0;
+
+}
+
+
+/*
+ * Number of features per node to request from DAAL.
+ */
+size_t df_features_per_node(const struct df_params &params,
+                            size_t n_features) {
+
+    return (params.features_per_node > 0
+            && params.features_per_node <= n_features)
+        ? params.features_per_node : n_features;
+
+}
+
+
+da::engines::EnginePtr df_engine(const std::string &engine, size_t seed) {
+
+    if (engine == "mt19937")
+        return da::engines::mt19937::Batch<double>::create(seed);
+    if (engine == "mcg59")
+        return da::engines::mcg59::Batch<double>::create(seed);
+    return da::engines::mt2203::Batch<double>::create(seed);
+
+}
+
+
+/*
+ * Set the training parameters shared by classification and regression.
+ */
+template <typename Parameter>
+void set_df_parameters(Parameter &parameter, const struct df_params &params,
+                       size_t n_features) {
+
+    parameter.nTrees = params.n_trees;
+    parameter.varImportance = df_var_importance(params.var_importance);
+    parameter.resultsToCompute = df_results_to_compute(params.oob);
+    parameter.observationsPerTreeFraction = params.samples_fraction;
+    parameter.maxTreeDepth = params.max_depth;
+    parameter.featuresPerNode = df_features_per_node(params, n_features);
+    parameter.minObservationsInLeafNode = params.min_leaf;
+    parameter.maxLeafNodes = params.max_leaf_nodes;
+    parameter.impurityThreshold = params.min_impurity;
+    parameter.bootstrap = params.bootstrap;
+    parameter.maxBins = params.max_bins;
+    parameter.engine = df_engine(params.engine, params.seed);
+
+}
+
+
+void print_df_params(const struct df_params &params, size_t n_features) {
+
+    std::cout << "@ {'nTrees': " << params.n_trees
+              << ", 'variable_importance': '" << params.var_importance << "'"
+              << ", 'oob': '" << params.oob << "'"
+              << ", 'features_per_node': "
+              << df_features_per_node(params, n_features)
+              << ", 'max_depth': " << params.max_depth
+              << ", 'min_leaf': " << params.min_leaf
+              << ", 'max_leaf_nodes': " << params.max_leaf_nodes
+              << ", 'min_impurity': " << params.min_impurity
+              << ", 'seed': " << params.seed
+              << ", 'engine': '" << params.engine << "'"
+              << ", 'samples_fraction': " << params.samples_fraction
+              << ", 'bootstrap': " << (params.bootstrap ? "True" : "False")
+              << ", 'method': '" << params.method << "'"
+              << ", 'max_bins': " << params.max_bins
+              << "}" << std::endl;
+
+}
+
+
+/*
+ * Features binned into quantiles, as a column-major matrix of bin indices
+ * of the smallest type which can hold them. Bin b of a feature holds the
+ * values in (edges[b - 1], edges[b]].
+ */
+struct binned_features {
+    std::vector<std::vector<double>> edges;
+    std::vector<uint8_t> bins8;
+    std::vector<uint16_t> bins16;
+    dm::NumericTablePtr table;  // SOA table of the bin matrix columns
+    size_t bytes;
+};
+
+typedef std::shared_ptr<binned_features> binned_features_ptr;
+
+// Rows sampled to find the quantiles of each feature
+#define BINNING_MAX_SAMPLES (1 << 18)
+
+
+/*
+ * Upper edges of up to max_bins quantile bins of column col of X.
+ */
+std::vector<double> quantile_edges(const double *X, size_t n_rows,
+                                   size_t n_cols, size_t col,
+                                   size_t max_bins) {
+
+    size_t step = std::max(n_rows / BINNING_MAX_SAMPLES, (size_t) 1);
+    std::vector<double> sample;
+    sample.reserve(n_rows / step + 1);
+    for (size_t i = 0; i < n_rows; i += step)
+        sample.push_back(X[i * n_cols + col]);
+    std::sort(sample.begin(), sample.end());
+
+    std::vector<double> edges;
+    for (size_t b = 1; b < max_bins; b++) {
+        double q = sample[b * sample.size() / max_bins];
+        if (edges.empty() || q > edges.back())
+            edges.push_back(q);
+    }
+    return edges;
+
+}
+
+
+template <typename Bin>
+void assign_bins(const double *X, size_t n_rows, size_t n_cols,
+                 const std::vector<std::vector<double>> &edges,
+                 std::vector<Bin> &bins) {
+
+    bins.resize(n_rows * n_cols);
+    tbb::parallel_for(tbb::blocked_range2d<size_t>(0, n_cols, 1,
+                                                   0, n_rows, 4096),
+        [&](const tbb::blocked_range2d<size_t> &r) {
+            for (size_t j = r.rows().begin(); j < r.rows().end(); j++) {
+                const std::vector<double> &e = edges[j];
+                Bin *column = bins.data() + j * n_rows;
+                for (size_t i = r.cols().begin(); i < r.cols().end(); i++) {
+                    column[i] = std::lower_bound(e.begin(), e.end(),
+                                                 X[i * n_cols + j])
+                        - e.begin();
+                }
+            }
+        });
+
+}
+
+
+template <typename Bin>
+dm::NumericTablePtr bin_table(std::vector<Bin> &bins, size_t n_rows,
+                              size_t n_cols) {
+
+    auto table = dm::SOANumericTable::create(n_cols, n_rows);
+    for (size_t j = 0; j < n_cols; j++) {
+        table->setArray(ds::SharedPtr<Bin>(bins.data() + j * n_rows,
+                                           ds::EmptyDeleter()), j);
+    }
+    return table;
+
+}
+
+
+/*
+ * Bin the features of X into at most max_bins quantiles each, in parallel
+ * over features (for the quantiles) and blocks of rows (for the bins).
+ */
+binned_features_ptr bin_features(dm::NumericTablePtr X_nt, size_t max_bins) {
+
+    size_t n_rows = X_nt->getNumberOfRows();
+    size_t n_cols = X_nt->getNumberOfColumns();
+    dm::BlockDescriptor<double> block;
+    X_nt->getBlockOfRows(0, n_rows, dm::readOnly, block);
+    const double *X = block.getBlockPtr();
+
+    binned_features_ptr binned(new binned_features);
+    binned->edges.resize(n_cols);
+    tbb::parallel_for(size_t(0), n_cols, [&](size_t j) {
+        binned->edges[j] = quantile_edges(X, n_rows, n_cols, j, max_bins);
+    });
+
+    if (max_bins <= 256) {
+        assign_bins(X, n_rows, n_cols, binned->edges, binned->bins8);
+        binned->table = bin_table(binned->bins8, n_rows, n_cols);
+        binned->bytes = binned->bins8.size() * sizeof(uint8_t);
+    } else {
+        assign_bins(X, n_rows, n_cols, binned->edges, binned->bins16);
+        binned->table = bin_table(binned->bins16, n_rows, n_cols);
+        binned->bytes = binned->bins16.size() * sizeof(uint16_t);
+    }
+
+    X_nt->releaseBlockOfRows(block);
+    return binned;
+
+}
+
+
+/*
+ * Size of the bin matrix compared with the features it was made from.
+ */
+void print_binning(binned_features_ptr binned, dm::NumericTablePtr X_nt) {
+
+    size_t raw_bytes = X_nt->getNumberOfRows() * X_nt->getNumberOfColumns()
+        * sizeof(double);
+    size_t max_edges = 0;
+    for (auto &e : binned->edges)
+        max_edges = std::max(max_edges, e.size());
+    std::cout << "@ Binned features: " << max_edges + 1
+              << " bins at most per feature, " << binned->bytes
+              << " bytes (" << raw_bytes << " bytes unbinned)" << std::endl;
+
+}
+
+
+/*
+ * Write the forest parameters of a CSV line. The method column is the
+ * training method, with the number of bins when features are binned,
+ * followed by the engine and the fraction of observations per tree.
+ */
+void write_df_meta(std::ostream &os, const struct df_params &params) {
+
+    os << params.n_trees << ','
+       << params.features_per_node << ','
+       << params.max_depth << ','
+       << params.min_impurity << ','
+       << params.bootstrap << ','
+       << params.method;
+    if (params.native_binning)
+        os << "+native";
+    if (params.native_binning || params.method == "hist")
+        os << '/' << params.max_bins;
+    os << ',' << params.engine << ','
+       << params.samples_fraction << ',';
+
+}
+
+
+/*
+ * Train a forest with each combination of --var-importance and --oob,
+ * reporting the time of each as <fit>.<mode>.oob_<results>, or just <fit>
+ * for the default of MDI without OOB results. With --compare-bootstrap,
+ * combinations which don't need bootstrap are also trained without it,
+ * as <fit>[.<mode>.oob_none].no_bootstrap. fit(verbose) trains with the
+ * combination in params, and oob_error(result) gets the OOB error table
+ * of a result. Returns the time and result of the first combination,
+ * which is used for prediction.
+ */
+template <typename Fit, typename OOBError>
+std::pair<double, typename std::result_of<Fit(bool)>::type>
+df_fit_sweep(bench_runner &runner, const std::string &fit,
+             struct df_params &params, struct timing_options &opts,
+             Fit fit_func, OOBError oob_error) {
+
+    typename std::result_of<Fit(bool)>::type first;
+    std::string first_function;
+    double first_time = 0.;
+
+    std::vector<bool> bootstraps = {params.bootstrap};
+    if (params.compare_bootstrap && params.bootstrap)
+        bootstraps.push_back(false);
+
+    // Permutation importance and OOB results need bootstrap
+    struct combination {
+        std::string mode, oob;
+        bool bootstrap;
+    };
+    std::vector<combination> combinations;
+    for (auto &mode : params.var_importance_sweep) {
+        for (auto &oob : params.oob_sweep) {
+            for (bool bootstrap : bootstraps) {
+                if (bootstrap || (mode.compare(0, 3, "MDA") != 0
+                                  && oob == "none"))
+                    combinations.push_back({mode, oob, bootstrap});
+            }
+        }
+    }
+
+    for (auto &c : combinations) {
+        params.var_importance = c.mode;
+        params.oob = c.oob;
+        params.bootstrap = c.bootstrap;
+        std::string function = fit;
+        if (c.mode != "MDI" || c.oob != "none")
+            function += "." + c.mode + ".oob_" + c.oob;
+        if (c.bootstrap != bootstraps[0])
+            function += ".no_bootstrap";
+
+        bool verbose_fit = runner.verbose();
+        double time;
+        typename std::result_of<Fit(bool)>::type result;
+        std::tie(time, result) = runner.time([&] {
+                auto r = fit_func(verbose_fit);
+                verbose_fit = false;
+                return r;
+            }, opts);
+        runner.report(function, time, "");
+
+        if (!first) {
+            first = result;
+            first_function = function;
+            first_time = time;
+        } else if (runner.verbose()) {
+            std::cout << "@ " << function << ": " << time / first_time
+                      << "x the time of " << first_function << std::endl;
+        }
+
+        if (runner.verbose() && (c.oob == "error" || c.oob == "all")) {
+            dm::NumericTablePtr error_nt = oob_error(result);
+            dm::BlockDescriptor<double> block;
+            error_nt->getBlockOfRows(0, 1, dm::readOnly, block);
+            std::cout << "@ " << function << ": OOB error "
+                      << block.getBlockPtr()[0] << std::endl;
+            error_nt->releaseBlockOfRows(block);
+        }
+    }
+
+    params.var_importance = params.var_importance_sweep[0];
+    params.oob = params.oob_sweep[0];
+    params.bootstrap = bootstraps[0];
+    return std::make_pair(first_time, first);
+
+}
+
+
+/*
+ * Suffix of the functions of a model with --min-leaf and --max-leaf-nodes,
+ * empty for the defaults of single observation leaves without a limit.
+ */
+std::string df_shape_suffix(const struct df_params &params) {
+
+    if (params.min_leaf == 1 && params.max_leaf_nodes == 0)
+        return "";
+    std::ostringstream suffix;
+    suffix << ".min_leaf_" << params.min_leaf
+           << ".max_leaf_nodes_" << params.max_leaf_nodes;
+    return suffix.str();
+
+}
+
+
+struct tree_stats {
+    size_t nodes = 0;
+    size_t leaves = 0;
+    size_t depth = 0;
+};
+
+
+struct forest_stats {
+    std::vector<tree_stats> trees;
+    size_t serialized_bytes;
+    size_t rss_before_fit;     // Bytes resident before training
+    size_t peak_rss_fit;       // Peak bytes resident while training
+    bool peak_rss_reset;       // Whether the peak is only of training
+};
+
+
+/*
+ * Tree visitor counting the nodes and leaves of a tree, and its depth.
+ */
+template <typename TreeNodeVisitor, typename LeafNodeDescriptor>
+class tree_stats_visitor : public TreeNodeVisitor {
+
+    public:
+        tree_stats stats;
+
+        bool onLeafNode(const LeafNodeDescriptor &desc) override {
+            stats.nodes++;
+            stats.leaves++;
+            stats.depth = std::max(stats.depth, desc.level);
+            return true;
+        }
+
+        bool onSplitNode(const dtu::SplitNodeDescriptor &) override {
+            stats.nodes++;
+            return true;
+        }
+
+};
+
+typedef tree_stats_visitor<dtu::classification::TreeNodeVisitor,
+                           dtu::classification::LeafNodeDescriptor>
+    clsf_tree_stats_visitor;
+typedef tree_stats_visitor<dtu::regression::TreeNodeVisitor,
+                           dtu::regression::LeafNodeDescriptor>
+    regr_tree_stats_visitor;
+
+
+/*
+ * Walk the trees of a trained model with Visitor and serialize it.
+ */
+template <typename Visitor, typename ModelPtr>
+void model_stats(ModelPtr model, struct forest_stats &stats) {
+
+    trace_span span("model_stats");
+    stats.trees.clear();
+    for (size_t t = 0; t < model->getNumberOfTrees(); t++) {
+        Visitor visitor;
+        model->traverseDFS(t, visitor);
+        stats.trees.push_back(visitor.stats);
+    }
+
+    dm::InputDataArchive archive;
+    model->serialize(archive);
+    stats.serialized_bytes = archive.getSizeOfArchive();
+
+}
+
+
+void print_forest_stats(const std::string &function,
+                        const struct forest_stats &stats, bool verbose) {
+
+    size_t n_trees = stats.trees.size();
+    if (n_trees == 0)
+        return;
+
+    size_t nodes = 0, leaves = 0;
+    std::vector<size_t> tree_nodes, depths;
+    for (auto &t : stats.trees) {
+        nodes += t.nodes;
+        leaves += t.leaves;
+        tree_nodes.push_back(t.nodes);
+        depths.push_back(t.depth);
+    }
+    std::sort(tree_nodes.begin(), tree_nodes.end());
+    std::sort(depths.begin(), depths.end());
+
+    std::cout << "@ " << function << ": " << n_trees << " trees, "
+              << nodes << " nodes (" << leaves << " leaves), "
+              << stats.serialized_bytes << " bytes serialized" << std::endl;
+    std::cout << "@ " << function << ": nodes per tree min/median/max "
+              << tree_nodes.front() << '/' << tree_nodes[n_trees / 2] << '/'
+              << tree_nodes.back() << ", depth min/median/max "
+              << depths.front() << '/' << depths[n_trees / 2] << '/'
+              << depths.back() << std::endl;
+    std::cout << "@ " << function << ": peak RSS "
+              << (stats.peak_rss_reset ? "in training " : "of process ")
+              << stats.peak_rss_fit / (1024 * 1024) << " MiB ("
+              << stats.rss_before_fit / (1024 * 1024)
+              << " MiB before training)" << std::endl;
+
+    if (verbose) {
+        for (size_t t = 0; t < n_trees; t++) {
+            std::cout << "@   tree " << t << ": " << stats.trees[t].nodes
+                      << " nodes, " << stats.trees[t].leaves << " leaves, "
+                      << "depth " << stats.trees[t].depth << std::endl;
+        }
+    }
+
+}
+
+
+/*
+ * Time training n single-tree forests one after the other, each with a
+ * different seed, where fit(params) trains a forest with the given
+ * parameters. Returns the time of each in seconds.
+ */
+template <typename Fit>
+std::vector<double> df_tree_times(const struct df_params &params, size_t n,
+                                  Fit fit) {
+
+    trace_span span("df_tree_times");
+    struct df_params one_tree = params;
+    one_tree.n_trees = 1;
+    std::vector<double> times;
+    for (size_t t = 0; t < n; t++) {
+        one_tree.seed = params.seed + t;
+        auto start = std::chrono::steady_clock::now();
+        fit(one_tree);
+        times.push_back(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count());
+    }
+    return times;
+
+}
+
+
+/*
+ * Time sampling the observations of n trees from n_rows rows: creating
+ * an engine and drawing the tree's share of row indices with it. This
+ * approximates what training does for each tree before growing it, since
+ * DAAL's own sampling isn't exposed. Returns the time of each in seconds.
+ */
+std::vector<double> df_sampling_times(const struct df_params &params,
+                                      size_t n_rows, size_t n) {
+
+    trace_span span("df_sampling_times");
+    size_t n_draws = (params.bootstrap || params.samples_fraction < 1.)
+        ? (size_t) (n_rows * params.samples_fraction) : 0;
+    auto indices_nt = dm::HomogenNumericTable<double>::create(
+            1, std::max(n_draws, (size_t) 1), dm::NumericTable::doAllocate);
+
+    std::vector<double> times;
+    for (size_t t = 0; t < n; t++) {
+        auto start = std::chrono::steady_clock::now();
+        da::engines::EnginePtr engine = df_engine(params.engine,
+                                                  params.seed + t);
+        if (n_draws > 0) {
+            da::distributions::uniform::Batch<double> uniform(0., n_rows);
+            uniform.parameter.engine = engine;
+            uniform.input.set(da::distributions::tableToFill, indices_nt);
+            uniform.compute();
+        }
+        times.push_back(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count());
+    }
+    return times;
+
+}
+
+
+void print_tree_times(const std::string &function,
+                      std::vector<double> tree_times,
+                      std::vector<double> sampling_times,
+                      double forest_time, size_t n_trees, bool verbose) {
+
+    size_t n = tree_times.size();
+    if (n == 0)
+        return;
+
+    if (verbose) {
+        for (size_t t = 0; t < n; t++) {
+            std::cout << "@   tree " << t << ": " << tree_times[t] * 1e3
+                      << " ms, sampling " << sampling_times[t] * 1e3
+                      << " ms" << std::endl;
+        }
+    }
+
+    std::sort(tree_times.begin(), tree_times.end());
+    std::sort(sampling_times.begin(), sampling_times.end());
+    double median = tree_times[n / 2];
+    std::cout << "@ " << function << ": " << n << " single-tree forests, "
+              << "ms per tree min/median/p90/max " << tree_times.front() * 1e3
+              << '/' << median * 1e3 << '/' << tree_times[n * 9 / 10] * 1e3
+              << '/' << tree_times.back() * 1e3 << "; "
+              << forest_time / n_trees * 1e3 << " ms per tree in a forest of "
+              << n_trees << std::endl;
+    std::cout << "@ " << function << ": sampling ms per tree min/median/max "
+              << sampling_times.front() * 1e3 << '/'
+              << sampling_times[n / 2] * 1e3 << '/'
+              << sampling_times.back() * 1e3 << ", "
+              << 100. * sampling_times[n / 2] / median
+              << "% of the median tree" << std::endl;
+
+}
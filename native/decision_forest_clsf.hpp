@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2018-2019 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cassert>
+
+#define DAAL_DATA_TYPE double
+#include "daal.h"
+#include "CLI11.hpp"
+#include "npyfile.h"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "decision_forest.hpp"
+#include "cv.hpp"
+#include "flat_forest.hpp"
+
+namespace dm=daal::data_management;
+namespace ds=daal::services;
+namespace da=daal::algorithms;
+namespace df=daal::algorithms::decision_forest;
+namespace dfc=daal::algorithms::decision_forest::classification;
+
+using namespace daal;
+using namespace da;
+
+
+template <dfc::training::Method method>
+dfc::training::ResultPtr
+df_classification_fit(
+    int nClasses,
+    const struct df_params &params,
+    dm::NumericTablePtr Xt,
+    dm::NumericTablePtr Yt)
+{
+    dfc::training::Batch<double, method> df_clsf_alg(nClasses);
+    set_df_parameters(df_clsf_alg.parameter, params, Xt->getNumberOfColumns());
+
+    df_clsf_alg.input.set(da::classifier::training::data, Xt);
+    df_clsf_alg.input.set(da::classifier::training::labels, Yt);
+
+    df_clsf_alg.compute();
+
+    return df_clsf_alg.getResult();
+}
+
+dfc::training::ResultPtr
+df_classification_fit(
+    int nClasses,
+    const struct df_params &params,
+    dm::NumericTablePtr Xt,
+    dm::NumericTablePtr Yt,
+    bool verbose)
+{
+    if (verbose)
+        print_df_params(params, Xt->getNumberOfColumns());
+
+    if (params.method == "hist")
+        return df_classification_fit<dfc::training::hist>(nClasses, params,
+                                                          Xt, Yt);
+    return df_classification_fit<dfc::training::defaultDense>(nClasses,
+                                                              params, Xt, Yt);
+}
+
+dm::NumericTablePtr
+df_classification_predict(
+    int nClasses,
+    dfc::training::ResultPtr training_result_ptr,
+    dm::NumericTablePtr Xt,
+    bool verbose
+    )
+{
+    // We explicitly specify float here to match sklearn.
+    dfc::prediction::Batch<float> pred_alg(nClasses);
+    pred_alg.input.set(da::classifier::prediction::data, Xt);
+    pred_alg.input.set(da::classifier::prediction::model,
+		       training_result_ptr->get(da::classifier::training::model));
+
+    pred_alg.compute();
+
+    da::classifier::prediction::ResultPtr pred_res = pred_alg.getResult();
+    dm::NumericTablePtr Y_pred_t = pred_res->get(da::classifier::prediction::prediction);
+
+    return Y_pred_t;
+}
+
+
+struct df_clsf_bench {
+
+    static const char *description() {
+        return "Native benchmark code for Intel(R) DAAL random forest classifier";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,classes,"
+               "n_trees,n_features_per_node,max_depth,"
+               "min_impurity,bootstrap,method,engine,samples_fraction,"
+               "function,accuracy,"
+               "time";
+    }
+
+    std::string xfn = "./data/mX.csv";
+    std::string yfn = "./data/mY.csv";
+    struct timing_options fit_opts = {100, 100, 10., 10};
+    struct timing_options predict_opts = {10, 100, 10., 10};
+    struct serving_options serve_opts;
+    struct cv_options cv_opts;
+    bool no_bootstrap = false;
+    struct df_params params;
+    bool flat_inference = false;
+
+    // Features used for training and prediction: X, or its bins
+    dm::NumericTablePtr X_nt, Y_nt, X_fit_nt;
+    binned_features_ptr bins;
+    int n_classes;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-x,--fileX,--file-X-train", xfn, "Feature file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        app.add_option("-y,--fileY,--file-y-train", yfn, "Labels file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "fit", fit_opts);
+        add_timing_args(app, "predict", predict_opts);
+        add_serving_args(app, serve_opts);
+        add_cv_args(app, cv_opts);
+
+        app.add_flag("--no-bootstrap", no_bootstrap,
+                     "Do not use bootstrap samples to build trees");
+
+        add_df_args(app, params);
+
+        app.add_flag("--flat-inference", flat_inference,
+                     "Also time prediction with the native flat forest "
+                     "engine, checking it against DAAL");
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        params.bootstrap = !no_bootstrap;
+        if (!check_df_params(params))
+            return false;
+
+        struct npyarr *arrX = load_array(xfn, 2, "X");
+        struct npyarr *arrY = load_array(yfn, 1, "y", "i8");
+        if (!arrX || !arrY)
+            return false;
+
+        /* Create numeric tables */
+        X_nt = dm::HomogenNumericTable<double>::create(
+                (double *) arrX->data, arrX->shape[1], arrX->shape[0]);
+        Y_nt = dm::HomogenNumericTable<int64_t>::create(
+                (int64_t *) arrY->data, 1, arrY->shape[0]);
+
+        size_t n_rows = Y_nt->getNumberOfRows();
+        size_t n_features = X_nt->getNumberOfColumns();
+        std::ostringstream string_size_stream;
+        string_size_stream << n_rows << 'x' << n_features;
+        ctx.size = string_size_stream.str();
+
+        n_classes = count_classes(Y_nt);
+        return check_cv_options(cv_opts, n_rows);
+
+    }
+
+    void write_meta(std::ostream &os) {
+        os << n_classes << ',';
+        write_df_meta(os, params);
+    }
+
+    void run(bench_runner &runner) {
+
+        double time;
+        X_fit_nt = X_nt;
+        if (params.native_binning) {
+            binned_features_ptr binned;
+            {
+                trace_span span("bin_features");
+                std::tie(time, binned) = runner.time([&] {
+                        return bin_features(X_nt, params.max_bins);
+                    }, fit_opts);
+            }
+            if (runner.verbose())
+                print_binning(binned, X_nt);
+            runner.report("df_clsf.bin", time, "");
+            X_fit_nt = binned->table;
+            bins = binned;
+        }
+
+        for (size_t min_leaf : params.min_leaf_sweep) {
+            for (size_t max_leaf_nodes : params.max_leaf_nodes_sweep) {
+                params.min_leaf = min_leaf;
+                params.max_leaf_nodes = max_leaf_nodes;
+                run_model(runner, df_shape_suffix(params));
+            }
+        }
+
+    }
+
+    /*
+     * Train and evaluate a model with the current --min-leaf and
+     * --max-leaf-nodes, whose functions are suffixed with shape.
+     */
+    void run_model(bench_runner &runner, const std::string &shape) {
+
+        double time;
+        struct forest_stats stats;
+        if (params.model_size) {
+            stats.rss_before_fit = read_rss();
+            stats.peak_rss_reset = reset_peak_rss();
+        }
+
+        double fit_time;
+        dfc::training::ResultPtr training_result;
+        std::tie(fit_time, training_result) = df_fit_sweep(
+            runner, "df_clsf.fit" + shape, params, fit_opts,
+            [&](bool verbose) {
+                return df_classification_fit(n_classes, params, X_fit_nt,
+                                             Y_nt, verbose);
+            },
+            [](dfc::training::ResultPtr r) {
+                return r->get(dfc::training::outOfBagError);
+            });
+
+        if (params.tree_times > 0) {
+            auto tree_times = df_tree_times(params, params.tree_times,
+                [&](const struct df_params &p) {
+                    return df_classification_fit(n_classes, p, X_fit_nt, Y_nt,
+                                                 false);
+                });
+            auto sampling_times = df_sampling_times(
+                    params, X_fit_nt->getNumberOfRows(), params.tree_times);
+            print_tree_times("df_clsf.tree" + shape, tree_times,
+                             sampling_times, fit_time, params.n_trees,
+                             runner.verbose());
+        }
+
+        if (params.model_size) {
+            stats.peak_rss_fit = read_peak_rss();
+            model_stats<clsf_tree_stats_visitor>(
+                training_result->get(dfc::training::model), stats);
+            print_forest_stats("df_clsf.model" + shape, stats,
+                               runner.verbose());
+        }
+
+        dm::NumericTablePtr Yp_nt;
+        std::tie(time, Yp_nt) = runner.time([&] {
+                return df_classification_predict(n_classes, training_result,
+                                                 X_fit_nt, runner.verbose());
+            }, predict_opts);
+
+        double accuracy = accuracy_score(Y_nt, Yp_nt) * 100.;
+        runner.report("df_clsf.predict" + shape, time, accuracy);
+
+        if (flat_inference) {
+            flat_forest forest;
+            std::tie(time, forest) = runner.time([&] {
+                    return flatten_forest(
+                        training_result->get(dfc::training::model),
+                        n_classes);
+                }, predict_opts);
+            runner.report("df_clsf.flatten" + shape, time, "");
+
+            dm::NumericTablePtr Yf_nt;
+            std::tie(time, Yf_nt) = runner.time([&] {
+                    return flat_forest_predict(forest, X_fit_nt);
+                }, predict_opts);
+
+            size_t n_rows = X_nt->getNumberOfRows();
+            size_t n_differ = n_rows - count_same_labels(Yp_nt, Yf_nt);
+            if (n_differ > 0) {
+                std::cerr << "warning: flat forest predictions differ from "
+                          << "DAAL on " << n_differ << " of " << n_rows
+                          << " rows" << std::endl;
+            }
+            accuracy = accuracy_score(Y_nt, Yf_nt) * 100.;
+            runner.report("df_clsf.predict_flat" + shape, time, accuracy);
+        }
+
+        runner.serve("df_clsf.serve" + shape, [&](dm::NumericTablePtr X) {
+                return df_classification_predict(n_classes, training_result,
+                                                 X, false);
+            }, X_fit_nt, serve_opts);
+
+        // Folds are cut from the features rather than their bins, which
+        // would be fitted on the test folds too
+        run_cv(runner, "df_clsf", X_nt, Y_nt, cv_opts,
+            [&](dm::NumericTablePtr X, dm::NumericTablePtr Y,
+                dm::NumericTablePtr X_test, dm::NumericTablePtr Y_test) {
+                auto r = df_classification_fit(n_classes, params, X, Y,
+                                               false);
+                auto Yp = df_classification_predict(n_classes, r, X_test,
+                                                    false);
+                return accuracy_score(Y_test, Yp) * 100.;
+            },
+            [&](const std::string &function, double time, double score) {
+                runner.report(function, time, score);
+            }, shape);
+
+    }
+
+};
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017-2019 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+
+#include <daal.h>
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "gemm_distances.hpp"
+
+dm::NumericTablePtr correlation_test(double *X, size_t rows, size_t cols) {
+
+    da::correlation_distance::Batch<double> algorithm;
+    algorithm.input.set(da::correlation_distance::data, make_table(X, rows, cols));
+    algorithm.compute();
+    return algorithm.getResult()->get(da::correlation_distance::correlationDistance);
+
+}
+
+
+dm::NumericTablePtr cosine_test(double *X, size_t rows, size_t cols) {
+
+    da::cosine_distance::Batch<double> algorithm;
+    algorithm.input.set(da::cosine_distance::data, make_table(X, rows, cols));
+    algorithm.compute();
+    return algorithm.getResult()->get(da::cosine_distance::cosineDistance);
+
+}
+
+
+struct distances_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL correlation and cosine "
+               "distances";
+    }
+
+    static const char *header() {
+        return "Batch,Arch,Prefix,Threads,Size,Function,Time";
+    }
+
+    struct timing_options timing_opts = {100, 100, 10., 10};
+    std::string stringSize = "1000x150000";
+    std::string xfn;
+    bool gemm = false;
+
+    std::vector<int> size;
+    double *X;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-s,--size", stringSize, "Problem size");
+
+        app.add_option("-x,--fileX,--file-X-train", xfn,
+                       "Feature file name (random data is used if not given)")
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "", timing_opts);
+
+        app.add_flag("--gemm", gemm,
+                     "Also time native distance kernels built on blocked "
+                     "MKL GEMM, comparing them with DAAL");
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        X = load_or_gen_random(xfn, size, stringSize);
+        if (!X)
+            return false;
+        ctx.size = stringSize;
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {}
+
+    template <typename Kernel>
+    void run_gemm(bench_runner &runner, const std::string &function,
+                  Kernel kernel, dm::NumericTablePtr daal_result,
+                  double daal_time) {
+
+        double time;
+        dm::NumericTablePtr result;
+        {
+            trace_span span("gemm", function);
+            std::tie(time, result) = runner.time([&] {
+                        return kernel(X, size[0], size[1]);
+                    }, timing_opts);
+        }
+
+        double n = size[0], d = size[1];
+        runner.work(2. * n * n * d, (n * d + n * n) * sizeof(double));
+        runner.report(function, time);
+
+        print_gemm_comparison(function, 2. * n * n * d, time, daal_time);
+        double diff = max_table_difference(result, daal_result);
+        if (diff > 1e-8) {
+            std::cerr << "warning: " << function << " differs from DAAL by "
+                      << "up to " << diff << std::endl;
+        }
+
+    }
+
+    void run(bench_runner &runner) {
+
+        double time;
+        dm::NumericTablePtr result;
+
+        std::tie(time, result) = runner.time([&] {
+                    return correlation_test(X, size[0], size[1]);
+                }, timing_opts);
+
+        // Pairwise distances are a GEMM of X with itself, writing an
+        // n x n result
+        double n = size[0], d = size[1];
+        runner.work(2. * n * n * d, (n * d + n * n) * sizeof(double));
+        runner.report("Correlation", time);
+
+        if (gemm) {
+            run_gemm(runner, "Correlation.gemm", gemm_correlation, result,
+                     time);
+        }
+
+        std::tie(time, result) = runner.time([&] {
+                    return cosine_test(X, size[0], size[1]);
+                }, timing_opts);
+        runner.work(2. * n * n * d, (n * d + n * n) * sizeof(double));
+        runner.report("Cosine", time);
+
+        if (gemm)
+            run_gemm(runner, "Cosine.gemm", gemm_cosine, result, time);
+
+    }
+
+};
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Preload npy datasets into POSIX shared memory (/dev/shm), so that
+ * benchmarks map them with load_shared_npy instead of reading the files.
+ * Shared memory objects stay around until removed with --remove or until
+ * the machine reboots.
+ */
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "CLI11.hpp"
+#include "npyfile.h"
+
+
+int main(int argc, char *argv[]) {
+
+    CLI::App app("Preload npy datasets into shared memory for native "
+                 "benchmarks");
+
+    std::vector<std::string> files;
+    app.add_option("files", files, "npy files to preload")
+        ->required()->check(CLI::ExistingFile);
+
+    bool remove = false;
+    app.add_flag("-r,--remove", remove,
+                 "Remove preloaded copies of the files instead");
+
+    bool verbose = false;
+    app.add_flag("-v,--verbose", verbose, "Output extra debug messages");
+
+    CLI11_PARSE(app, argc, argv);
+
+    int status = EXIT_SUCCESS;
+    for (auto &fn : files) {
+
+        char name[PATH_MAX + 8];
+        shared_npy_name(fn.c_str(), name, sizeof(name));
+
+        if (remove) {
+            if (shm_unlink(name) != 0) {
+                std::cerr << "error: " << fn << " is not preloaded"
+                          << std::endl;
+                status = EXIT_FAILURE;
+            } else if (verbose) {
+                std::cout << "@ Removed " << name << std::endl;
+            }
+            continue;
+        }
+
+        struct npyarr *arr = load_npy(fn.c_str());
+        if (!arr) {
+            std::cerr << "error: failed to load " << fn << std::endl;
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        if (save_shared(arr, name, fn.c_str()) != 0) {
+            std::cerr << "error: failed to preload " << fn << " into "
+                      << name << std::endl;
+            status = EXIT_FAILURE;
+        } else if (verbose) {
+            std::cout << "@ Preloaded " << fn << " (" << arr->descr;
+            for (size_t i = 0; i < arr->shape_len; i++)
+                std::cout << (i == 0 ? ", " : "x") << arr->shape[i];
+            std::cout << ") into " << name << std::endl;
+        }
+
+        free_npy(arr);
+    }
+
+    return status;
+
+}
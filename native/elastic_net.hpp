@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native benchmark of L1-regularized linear regression: DAAL's elastic
+ * net, or lasso regression, trained by coordinate descent.
+ *
+ * Models are fitted along a path of decreasing --alpha for each
+ * --l1-ratio, as for feature selection, with each fit warm started from
+ * the coefficients of the previous one. --compare-cold also fits each
+ * point from zero. Penalties are mapped from alpha and l1_ratio as
+ * scikit-learn defines them: an L1 penalty of alpha * l1_ratio and an L2
+ * penalty of alpha * (1 - l1_ratio). Each fit reports the coordinate
+ * descent iterations it took and the number of nonzero coefficients.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "daal.h"
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+
+namespace den = da::elastic_net;
+namespace dlr = da::lasso_regression;
+namespace dcd = da::optimization_solver::coordinate_descent;
+namespace dis = da::optimization_solver::iterative_solver;
+
+
+struct elastic_net_params {
+    std::string solver;     // elastic_net or lasso
+    double alpha;
+    double l1_ratio;        // Only for elastic_net
+    double tol;
+    size_t max_iter;
+    bool fit_intercept;
+};
+
+
+struct elastic_net_fit {
+    da::linear_model::ModelPtr model;
+    dm::NumericTablePtr beta;  // k x (d + 1), intercepts first
+    size_t iterations;
+};
+
+
+/*
+ * A 1 x k table of the same penalty for each of k responses.
+ */
+dm::NumericTablePtr penalty_table(double penalty, size_t k) {
+
+    auto table = dm::HomogenNumericTable<double>::create(
+            k, 1, dm::NumericTable::doAllocate);
+    std::fill(table->getArray(), table->getArray() + k, penalty);
+    return table;
+
+}
+
+
+/*
+ * Coefficients of a k x (d + 1) beta table as a (d + 1) x k starting
+ * argument of coordinate descent.
+ */
+dm::NumericTablePtr beta_argument(dm::NumericTablePtr beta) {
+
+    size_t k = beta->getNumberOfRows(), d1 = beta->getNumberOfColumns();
+    auto argument = dm::HomogenNumericTable<double>::create(
+            k, d1, dm::NumericTable::doAllocate);
+    dm::BlockDescriptor<double> block;
+    beta->getBlockOfRows(0, k, dm::readOnly, block);
+    const double *b = block.getBlockPtr();
+    double *a = argument->getArray();
+    for (size_t r = 0; r < k; r++) {
+        for (size_t j = 0; j < d1; j++)
+            a[j * k + r] = b[r * d1 + j];
+    }
+    beta->releaseBlockOfRows(block);
+    return argument;
+
+}
+
+
+ds::SharedPtr<dcd::Batch<double>>
+coordinate_descent_solver(const struct elastic_net_params &params,
+                          dm::NumericTablePtr start) {
+
+    ds::SharedPtr<dcd::Batch<double>> solver(new dcd::Batch<double>);
+    solver->parameter.nIterations = params.max_iter;
+    solver->parameter.accuracyThreshold = params.tol;
+    // Training starts from the solver's argument when it is set
+    if (start)
+        solver->input.set(dis::inputArgument, start);
+    return solver;
+
+}
+
+
+size_t solver_iterations(ds::SharedPtr<dcd::Batch<double>> solver) {
+
+    dm::NumericTablePtr n_iter = solver->getResult()->get(dis::nIterations);
+    if (!n_iter)
+        return 0;
+    dm::BlockDescriptor<int> block;
+    n_iter->getBlockOfRows(0, 1, dm::readOnly, block);
+    size_t iterations = block.getBlockPtr()[0];
+    n_iter->releaseBlockOfRows(block);
+    return iterations;
+
+}
+
+
+/*
+ * Fit with the given parameters, from the coefficients start if given
+ * (a (d + 1) x k table, see beta_argument) or else from zero.
+ */
+struct elastic_net_fit
+elastic_net_train(const struct elastic_net_params &params,
+                  dm::NumericTablePtr X, dm::NumericTablePtr y,
+                  dm::NumericTablePtr start) {
+
+    size_t k = y->getNumberOfColumns();
+    auto solver = coordinate_descent_solver(params, start);
+    struct elastic_net_fit fit;
+
+    if (params.solver == "lasso") {
+        dlr::training::Batch<double> algorithm;
+        algorithm.input.set(dlr::training::data, X);
+        algorithm.input.set(dlr::training::dependentVariables, y);
+        algorithm.parameter.lassoParameters = penalty_table(params.alpha, k);
+        algorithm.parameter.interceptFlag = params.fit_intercept;
+        algorithm.parameter.optimizationSolver = solver;
+        algorithm.compute();
+        fit.model = algorithm.getResult()->get(dlr::training::model);
+    } else {
+        den::training::Batch<double> algorithm;
+        algorithm.input.set(den::training::data, X);
+        algorithm.input.set(den::training::dependentVariables, y);
+        algorithm.parameter.penaltyL1 = penalty_table(
+                params.alpha * params.l1_ratio, k);
+        algorithm.parameter.penaltyL2 = penalty_table(
+                params.alpha * (1. - params.l1_ratio), k);
+        algorithm.parameter.interceptFlag = params.fit_intercept;
+        algorithm.parameter.optimizationSolver = solver;
+        algorithm.compute();
+        fit.model = algorithm.getResult()->get(den::training::model);
+    }
+
+    fit.beta = fit.model->getBeta();
+    fit.iterations = solver_iterations(solver);
+    return fit;
+
+}
+
+
+dm::NumericTablePtr elastic_net_predict(const std::string &solver,
+                                        da::linear_model::ModelPtr model,
+                                        dm::NumericTablePtr X) {
+
+    if (solver == "lasso") {
+        dlr::prediction::Batch<double> algorithm;
+        algorithm.input.set(dlr::prediction::data, X);
+        algorithm.input.set(dlr::prediction::model,
+                            ds::dynamicPointerCast<dlr::Model>(model));
+        algorithm.compute();
+        return algorithm.getResult()->get(dlr::prediction::prediction);
+    }
+
+    den::prediction::Batch<double> algorithm;
+    algorithm.input.set(den::prediction::data, X);
+    algorithm.input.set(den::prediction::model,
+                        ds::dynamicPointerCast<den::Model>(model));
+    algorithm.compute();
+    return algorithm.getResult()->get(den::prediction::prediction);
+
+}
+
+
+/*
+ * Coefficients (not intercepts) of a k x (d + 1) beta table which aren't
+ * zero.
+ */
+size_t count_nonzero_coefficients(dm::NumericTablePtr beta) {
+
+    size_t k = beta->getNumberOfRows(), d1 = beta->getNumberOfColumns();
+    dm::BlockDescriptor<double> block;
+    beta->getBlockOfRows(0, k, dm::readOnly, block);
+    const double *b = block.getBlockPtr();
+    size_t nonzero = 0;
+    for (size_t r = 0; r < k; r++) {
+        for (size_t j = 1; j < d1; j++)
+            nonzero += b[r * d1 + j] != 0.;
+    }
+    beta->releaseBlockOfRows(block);
+    return nonzero;
+
+}
+
+
+/*
+ * Suffix of function names for the point of the path of the given
+ * parameters, e.g. .alpha_0.1.l1_0.5, so that the results store doesn't
+ * pool points.
+ */
+std::string elastic_net_suffix(const struct elastic_net_params &params) {
+
+    std::ostringstream suffix;
+    suffix << ".alpha_" << params.alpha;
+    if (params.solver != "lasso")
+        suffix << ".l1_" << params.l1_ratio;
+    return suffix.str();
+
+}
+
+
+struct elastic_net_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL elastic net and lasso "
+               "regression";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,solver,tol,max_iter,"
+               "function,alpha,l1_ratio,iterations,nonzero,time";
+    }
+
+    struct timing_options fit_opts = {10, 100, 10., 10};
+    struct timing_options predict_opts = {10, 100, 10., 10};
+    std::string stringSize = "100000x1000";
+    std::string xfn, yfn;
+    struct elastic_net_params params;
+    std::vector<double> alphas = {1.};
+    std::vector<double> l1_ratios = {0.5};
+    bool no_warm_start = false;
+    bool compare_cold = false;
+
+    std::vector<int> size, y_size;
+    double *X, *y;
+    dm::NumericTablePtr X_nt, y_nt;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-s,--size", stringSize, "Problem size");
+
+        app.add_option("-x,--fileX,--file-X-train", xfn,
+                       "Feature file name (random data is used if not given)")
+            ->check(CLI::ExistingFile);
+        app.add_option("-y,--fileY,--file-y-train", yfn,
+                       "Target file name (random data is used if not given)")
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "fit", fit_opts);
+        add_timing_args(app, "predict", predict_opts);
+
+        params.solver = "elastic_net";
+        app.add_option("--solver", params.solver,
+                       "DAAL algorithm: elastic_net, or lasso (which takes "
+                       "no --l1-ratio)", true)
+            ->check(CLI::IsMember({"elastic_net", "lasso"}));
+
+        app.add_option("--alpha", alphas,
+                       "Regularization strengths of the path, fitted from "
+                       "the largest down", true)
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--l1-ratio", l1_ratios,
+                       "Share of L1 in the penalty; a path is fitted for "
+                       "each", true)
+            ->check(CLI::Range(0., 1.));
+
+        params.tol = 1e-4;
+        app.add_option("--tol", params.tol,
+                       "Tolerance of coordinate descent", true)
+            ->check(CLI::PositiveNumber);
+
+        params.max_iter = 1000;
+        app.add_option("--maxiter", params.max_iter,
+                       "Maximum iterations of coordinate descent", true)
+            ->check(CLI::PositiveNumber);
+
+        params.fit_intercept = true;
+
+        app.add_flag("--no-warm-start", no_warm_start,
+                     "Fit each point of the path from zero instead of "
+                     "from the previous point's coefficients");
+
+        app.add_flag("--compare-cold", compare_cold,
+                     "Also fit each point of the path from zero, timing "
+                     "both");
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        X = load_or_gen_random(xfn, size, stringSize);
+        if (!X)
+            return false;
+        std::string yStringSize = std::to_string(size[0]) + "x1";
+        y = load_or_gen_random(yfn, y_size, yStringSize);
+        if (!y)
+            return false;
+        if (y_size[0] != size[0]) {
+            std::cerr << "error: X has " << size[0] << " rows but y has "
+                      << y_size[0] << std::endl;
+            return false;
+        }
+        {
+            trace_span span("make_table");
+            X_nt = make_table(X, size[0], size[1]);
+            y_nt = make_table(y, y_size[0], y_size[1]);
+        }
+
+        // Each path goes from the strongest regularization down, where
+        // few coefficients are nonzero and warm starts help most
+        std::sort(alphas.begin(), alphas.end(), std::greater<double>());
+        if (params.solver == "lasso")
+            l1_ratios = {1.};
+
+        ctx.size = stringSize;
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {
+        os << params.solver << ',' << params.tol << ',' << params.max_iter
+           << ',';
+    }
+
+    /*
+     * Time a fit from start, reporting it as function with the suffix of
+     * its point of the path.
+     */
+    struct elastic_net_fit time_fit(bench_runner &runner,
+                                    const std::string &function,
+                                    dm::NumericTablePtr start) {
+
+        double time;
+        struct elastic_net_fit fit;
+        std::tie(time, fit) = runner.time([&] {
+                return elastic_net_train(params, X_nt, y_nt, start);
+            }, fit_opts);
+        runner.report(function + elastic_net_suffix(params), time,
+                      params.alpha, params.l1_ratio, fit.iterations,
+                      count_nonzero_coefficients(fit.beta));
+        return fit;
+
+    }
+
+    void run(bench_runner &runner) {
+
+        std::string prefix = params.solver == "lasso" ? "Lasso"
+                                                      : "ElasticNet";
+        struct elastic_net_fit fit;
+
+        for (double l1_ratio : l1_ratios) {
+            params.l1_ratio = l1_ratio;
+            dm::NumericTablePtr start;
+            size_t warm_iterations = 0, cold_iterations = 0;
+
+            for (double alpha : alphas) {
+                params.alpha = alpha;
+                bool warm = (bool) start;
+                fit = time_fit(runner, prefix + ".fit", start);
+                warm_iterations += fit.iterations;
+                if (!no_warm_start)
+                    start = beta_argument(fit.beta);
+
+                if (!warm) {
+                    cold_iterations += fit.iterations;
+                } else if (compare_cold) {
+                    auto cold = time_fit(runner, prefix + ".fit_cold",
+                                         dm::NumericTablePtr());
+                    cold_iterations += cold.iterations;
+                }
+            }
+
+            if (runner.verbose() && compare_cold) {
+                std::cout << "@ " << prefix << " path of " << alphas.size()
+                          << " alphas with l1_ratio " << l1_ratio << ": "
+                          << warm_iterations << " iterations warm started, "
+                          << cold_iterations << " from zero" << std::endl;
+            }
+        }
+
+        // Predict with the model at the end of the last path
+        double time;
+        dm::NumericTablePtr y_pred;
+        std::tie(time, y_pred) = runner.time([&] {
+                return elastic_net_predict(params.solver, fit.model, X_nt);
+            }, predict_opts);
+        double n = size[0], d = size[1], k = y_size[1];
+        runner.work(2. * n * d * k, n * (d + k) * sizeof(double));
+        runner.report(prefix + ".predict" + elastic_net_suffix(params),
+                      time, params.alpha, params.l1_ratio, "",
+                      count_nonzero_coefficients(fit.beta));
+
+    }
+
+};
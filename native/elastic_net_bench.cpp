@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "elastic_net.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    return run_benchmark<elastic_net_bench>(argc, argv);
+
+}
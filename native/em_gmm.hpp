@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native benchmark of Gaussian mixture models fitted by DAAL's EM
+ * algorithm, with full or diagonal covariances, as used for anomaly
+ * scoring.
+ *
+ * For each --covariance type, each number of --features (the first
+ * columns of the data) and each number of --components, the init step
+ * (short EM runs from random starts, keeping the most likely) and EM
+ * from its result are timed. EM is run to convergence in one call, which
+ * reports its iterations and final log-likelihood, and then again one
+ * iteration per call from the same start, which times each iteration
+ * and records the log-likelihood after it. With -v, the time to converge
+ * is tabulated over components and features to show how it scales.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <random>
+#include <sstream>
+#include <chrono>
+#include <utility>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "daal.h"
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+
+namespace dem = da::em_gmm;
+
+
+struct em_gmm_params {
+    size_t n_components;
+    std::string covariance;     // full or diagonal
+    double tol;
+    size_t max_iter;
+    double reg;                 // Added to covariance diagonals
+    size_t init_trials;
+    size_t init_iterations;
+    size_t seed;
+};
+
+
+dem::CovarianceStorageId
+covariance_storage(const struct em_gmm_params &params) {
+
+    return params.covariance == "diagonal" ? dem::diagonal : dem::full;
+
+}
+
+
+/*
+ * n x d rows drawn from k Gaussians with unit variance, around centers
+ * drawn uniformly from [-5, 5]^d.
+ */
+std::vector<double> gen_mixture(size_t n, size_t d, size_t k,
+                                unsigned seed) {
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> center(-5., 5.);
+    std::uniform_int_distribution<size_t> component(0, k - 1);
+    std::normal_distribution<double> noise;
+
+    std::vector<double> centers(k * d);
+    for (auto &c : centers)
+        c = center(rng);
+    std::vector<double> X(n * d);
+    for (size_t i = 0; i < n; i++) {
+        const double *c = &centers[component(rng) * d];
+        for (size_t j = 0; j < d; j++)
+            X[i * d + j] = c[j] + noise(rng);
+    }
+    return X;
+
+}
+
+
+/* The first f of the d columns of the n x d matrix X */
+std::vector<double> first_columns(const double *X, size_t n, size_t d,
+                                  size_t f) {
+
+    std::vector<double> columns(n * f);
+    for (size_t i = 0; i < n; i++)
+        std::copy(X + i * d, X + i * d + f, &columns[i * f]);
+    return columns;
+
+}
+
+
+/* The first value of a table, such as a 1 x 1 result */
+double first_value(dm::NumericTablePtr table) {
+
+    dm::BlockDescriptor<double> block;
+    table->getBlockOfRows(0, 1, dm::readOnly, block);
+    double value = block.getBlockPtr()[0];
+    table->releaseBlockOfRows(block);
+    return value;
+
+}
+
+
+dem::init::ResultPtr em_gmm_init(const struct em_gmm_params &params,
+                                 dm::NumericTablePtr X) {
+
+    dem::init::Batch<double> algorithm(params.n_components);
+    algorithm.input.set(dem::init::data, X);
+    algorithm.parameter.nTrials = params.init_trials;
+    algorithm.parameter.nIterations = params.init_iterations;
+    algorithm.parameter.accuracyThreshold = params.tol;
+    algorithm.parameter.covarianceStorage = covariance_storage(params);
+    algorithm.parameter.engine
+        = da::engines::mt19937::Batch<double>::create(params.seed);
+    algorithm.compute();
+    return algorithm.getResult();
+
+}
+
+
+/*
+ * EM from the given weights, means and covariances, for at most
+ * max_iter iterations.
+ */
+dem::ResultPtr em_gmm_fit(const struct em_gmm_params &params,
+                          dm::NumericTablePtr X,
+                          dm::NumericTablePtr weights,
+                          dm::NumericTablePtr means,
+                          dm::DataCollectionPtr covariances,
+                          size_t max_iter) {
+
+    dem::Batch<double> algorithm(params.n_components);
+    algorithm.input.set(dem::data, X);
+    algorithm.input.set(dem::inputWeights, weights);
+    algorithm.input.set(dem::inputMeans, means);
+    algorithm.input.set(dem::inputCovariances, covariances);
+    algorithm.parameter.maxIterations = max_iter;
+    algorithm.parameter.accuracyThreshold = params.tol;
+    algorithm.parameter.regularizationFactor = params.reg;
+    algorithm.parameter.covarianceStorage = covariance_storage(params);
+    algorithm.compute();
+    return algorithm.getResult();
+
+}
+
+
+/* EM to convergence from the result of the init step */
+dem::ResultPtr em_gmm_fit(const struct em_gmm_params &params,
+                          dm::NumericTablePtr X, dem::init::ResultPtr init) {
+
+    return em_gmm_fit(params, X, init->get(dem::init::weights),
+                      init->get(dem::init::means),
+                      init->get(dem::init::covariances), params.max_iter);
+
+}
+
+
+/*
+ * Suffix of function names for the covariance type, components and
+ * features of the fit, e.g. .full.k_8.d_50, so that the results store
+ * doesn't pool the sweep.
+ */
+std::string em_gmm_suffix(const struct em_gmm_params &params,
+                          size_t n_features) {
+
+    std::ostringstream suffix;
+    suffix << '.' << params.covariance << ".k_" << params.n_components
+           << ".d_" << n_features;
+    return suffix.str();
+
+}
+
+
+struct em_gmm_iteration {
+    double time;            // In seconds
+    double log_likelihood;  // After the iteration
+};
+
+
+/*
+ * Run EM from the result of the init step one iteration per call, each
+ * starting from the model of the last, until the log-likelihood changes
+ * by less than tol (as DAAL's stopping criterion) or after max_iter
+ * iterations.
+ */
+std::vector<struct em_gmm_iteration>
+em_gmm_iterations(const struct em_gmm_params &params, dm::NumericTablePtr X,
+                  dem::init::ResultPtr init) {
+
+    typedef std::chrono::steady_clock clock;
+    trace_span span("em_gmm_iterations");
+    dm::NumericTablePtr weights = init->get(dem::init::weights);
+    dm::NumericTablePtr means = init->get(dem::init::means);
+    dm::DataCollectionPtr covariances = init->get(dem::init::covariances);
+
+    std::vector<struct em_gmm_iteration> iterations;
+    for (size_t i = 0; i < params.max_iter; i++) {
+        auto t0 = clock::now();
+        dem::ResultPtr result = em_gmm_fit(params, X, weights, means,
+                                           covariances, 1);
+        auto t1 = clock::now();
+
+        struct em_gmm_iteration iteration;
+        iteration.time = std::chrono::duration<double>(t1 - t0).count();
+        iteration.log_likelihood = first_value(
+                result->get(dem::goalFunction));
+        iterations.push_back(iteration);
+        if (i > 0 && std::abs(iteration.log_likelihood
+                              - iterations[i - 1].log_likelihood)
+                     < params.tol)
+            break;
+
+        weights = result->get(dem::weights);
+        means = result->get(dem::means);
+        covariances = result->get(dem::covariances);
+    }
+    return iterations;
+
+}
+
+
+struct em_gmm_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL EM for Gaussian mixture "
+               "models";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,tol,max_iter,function,"
+               "covariance,components,features,iterations,log_likelihood,"
+               "time";
+    }
+
+    struct timing_options init_opts = {10, 100, 10., 10};
+    struct timing_options fit_opts = {10, 100, 10., 10};
+    std::string stringSize = "100000x50";
+    std::string xfn;
+    struct em_gmm_params params;
+    std::vector<std::string> covariances = {"full", "diagonal"};
+    std::vector<size_t> components = {2, 4, 8, 16};
+    std::vector<size_t> features;
+    size_t gen_components = 8;
+    bool no_per_iteration = false;
+
+    std::vector<int> size;
+    std::vector<double> X_gen;
+    double *X;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-s,--size", stringSize,
+                       "Problem size of generated data", true);
+
+        app.add_option("-x,--fileX,--file-X-train", xfn,
+                       "Feature file name (a generated mixture is used if "
+                       "not given)")
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "init", init_opts);
+        add_timing_args(app, "fit", fit_opts);
+
+        app.add_option("--covariance", covariances,
+                       "Covariance types to sweep", true)
+            ->check(CLI::IsMember({"full", "diagonal"}));
+
+        app.add_option("--components", components,
+                       "Numbers of mixture components to sweep", true)
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--features", features,
+                       "Numbers of features to sweep, using the first "
+                       "columns of the data (all of them if not given)")
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--gen-components", gen_components,
+                       "Components of the generated mixture", true)
+            ->check(CLI::PositiveNumber);
+
+        params.tol = 1e-3;
+        app.add_option("--tol", params.tol,
+                       "Change of log-likelihood at which EM stops", true)
+            ->check(CLI::PositiveNumber);
+
+        params.max_iter = 100;
+        app.add_option("--maxiter", params.max_iter,
+                       "Maximum iterations of EM", true)
+            ->check(CLI::PositiveNumber);
+
+        params.reg = 0.01;
+        app.add_option("--reg", params.reg,
+                       "Regularization added to covariance diagonals",
+                       true)
+            ->check(CLI::Range(0., 1e6));
+
+        params.init_trials = 20;
+        app.add_option("--init-trials", params.init_trials,
+                       "Random starts of the init step", true)
+            ->check(CLI::PositiveNumber);
+
+        params.init_iterations = 10;
+        app.add_option("--init-iterations", params.init_iterations,
+                       "EM iterations of each start of the init step",
+                       true)
+            ->check(CLI::PositiveNumber);
+
+        params.seed = 777;
+        app.add_option("--seed", params.seed,
+                       "Seed of the init step and generated data", true);
+
+        app.add_flag("--no-per-iteration", no_per_iteration,
+                     "Don't run EM one iteration at a time to time each "
+                     "iteration");
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        if (xfn.empty()) {
+            parse_size(stringSize, size);
+            check_dims(size, 2);
+            X_gen = gen_mixture(size[0], size[1], gen_components,
+                                params.seed);
+            X = X_gen.data();
+        } else {
+            X = load_or_gen_random(xfn, size, stringSize);
+            if (!X)
+                return false;
+        }
+
+        if (features.empty())
+            features = {(size_t) size[1]};
+        for (size_t f : features) {
+            if (f > (size_t) size[1]) {
+                std::cerr << "error: can't use " << f << " features of "
+                          << "data with " << size[1] << std::endl;
+                return false;
+            }
+        }
+        for (size_t k : components) {
+            if (k > (size_t) size[0]) {
+                std::cerr << "error: can't fit " << k << " components to "
+                          << size[0] << " rows" << std::endl;
+                return false;
+            }
+        }
+
+        ctx.size = stringSize;
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {
+        os << params.tol << ',' << params.max_iter << ',';
+    }
+
+    /*
+     * Print the time to converge of each number of components (rows) and
+     * features (columns), and the time per iteration over the model's
+     * size (k d^2 for full covariances, k d for diagonal) relative to the
+     * first fit, which stays near 1 when time scales with the model.
+     */
+    void print_scaling(const std::string &covariance,
+                       const std::vector<double> &times,
+                       const std::vector<size_t> &iterations) {
+
+        std::cout << "@ EM_GMM " << covariance << " covariances: time to "
+                  << "converge (ms) / relative time per iteration and "
+                  << "model size" << std::endl;
+        std::cout << "@ " << std::setw(10) << "k \\ d";
+        for (size_t f : features)
+            std::cout << std::setw(18) << f;
+        std::cout << std::endl;
+
+        double base = 0.;
+        for (size_t c = 0; c < components.size(); c++) {
+            std::cout << "@ " << std::setw(10) << components[c];
+            for (size_t f = 0; f < features.size(); f++) {
+                size_t i = f * components.size() + c;
+                double d = features[f];
+                double model = components[c]
+                               * (covariance == "full" ? d * d : d);
+                double per_unit = times[i]
+                                  / std::max(iterations[i], (size_t) 1)
+                                  / model;
+                if (base == 0.)
+                    base = per_unit;
+                std::ostringstream cell;
+                cell << std::fixed << std::setprecision(1)
+                     << times[i] * 1e3 << " / " << std::setprecision(2)
+                     << per_unit / base;
+                std::cout << std::setw(18) << cell.str();
+            }
+            std::cout << std::endl;
+        }
+
+    }
+
+    void run(bench_runner &runner) {
+
+        size_t n = size[0], d = size[1];
+        for (auto &covariance : covariances) {
+            params.covariance = covariance;
+            std::vector<double> fit_times;
+            std::vector<size_t> fit_iterations;
+
+            for (size_t f : features) {
+                std::vector<double> X_f;
+                dm::NumericTablePtr X_nt;
+                if (f == d) {
+                    X_nt = make_table(X, n, d);
+                } else {
+                    X_f = first_columns(X, n, d, f);
+                    X_nt = make_table(X_f.data(), n, f);
+                }
+
+                for (size_t k : components) {
+                    params.n_components = k;
+                    std::string suffix = em_gmm_suffix(params, f);
+                    double time;
+                    dem::init::ResultPtr init;
+                    std::tie(time, init) = runner.time([&] {
+                            return em_gmm_init(params, X_nt);
+                        }, init_opts);
+                    runner.report("EM_GMM.init" + suffix, time, covariance,
+                                  k, f, "", "");
+
+                    dem::ResultPtr result;
+                    std::tie(time, result) = runner.time([&] {
+                            return em_gmm_fit(params, X_nt, init);
+                        }, fit_opts);
+                    size_t iterations = first_value(
+                            result->get(dem::nIterations));
+                    runner.report("EM_GMM.fit" + suffix, time, covariance,
+                                  k, f, iterations,
+                                  first_value(result->get(
+                                          dem::goalFunction)));
+                    fit_times.push_back(time);
+                    fit_iterations.push_back(iterations);
+
+                    if (no_per_iteration)
+                        continue;
+                    auto steps = em_gmm_iterations(params, X_nt, init);
+                    // Iterations of a fit are stored as samples of one key
+                    for (size_t i = 0; i < steps.size(); i++) {
+                        runner.report_measured("EM_GMM.iteration" + suffix,
+                                               steps[i].time, covariance, k,
+                                               f, i + 1,
+                                               steps[i].log_likelihood);
+                    }
+                }
+            }
+
+            if (runner.verbose())
+                print_scaling(covariance, fit_times, fit_iterations);
+        }
+
+    }
+
+};
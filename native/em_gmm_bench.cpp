@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "em_gmm.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    return run_benchmark<em_gmm_bench>(argc, argv);
+
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native inference engine for DAAL decision forests, benchmarked against
+ * DAAL prediction with --flat-inference.
+ *
+ * A trained model is exported through DAAL's tree visitor API into flat
+ * arrays of node fields (structure of arrays), with the nodes of each tree
+ * in breadth-first order and the two children of a node next to each
+ * other, so a node only needs the index of its left child. Leaves are
+ * their own left child with an infinite threshold, so every row can take
+ * exactly depth steps down a tree without branching on whether it has
+ * reached a leaf. Rows are scored in blocks, walking several rows down
+ * each tree at once so the compiler can vectorize the steps with gathers.
+ *
+ * Like the float DAAL prediction used by the benchmarks, features are
+ * compared in single precision.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+#include "daal.h"
+#include "common.hpp"
+
+namespace dm = daal::data_management;
+namespace da = daal::algorithms;
+namespace dtu = daal::algorithms::tree_utils;
+namespace dfc = daal::algorithms::decision_forest::classification;
+namespace dfr = daal::algorithms::decision_forest::regression;
+
+// Rows walked down a tree together
+#define FLAT_FOREST_LANES 16
+// Rows scored by one task
+#define FLAT_FOREST_BLOCK 256
+
+
+struct flat_forest {
+    size_t n_outputs;            // Classes, or 1 for regression
+    bool classification;
+    std::vector<int32_t> feature;   // Split feature, 0 for leaves
+    std::vector<float> threshold;   // Split value, infinity for leaves
+    std::vector<int32_t> left;      // Left child; the right one follows it
+    std::vector<int32_t> value;     // Offset of a leaf's outputs
+    std::vector<float> leaf_values; // n_outputs values of each leaf
+    std::vector<int32_t> root;      // Root node of each tree
+    std::vector<int32_t> depth;     // Steps from each root to its leaves
+};
+
+
+/*
+ * A node of a tree in the order DAAL visits it (depth first, preorder).
+ */
+struct visited_node {
+    size_t level;
+    bool leaf;
+    int32_t feature;
+    float threshold;
+    int32_t left = -1, right = -1;
+    std::vector<float> values;
+};
+
+
+/*
+ * Link the children of nodes in preorder: a node's parent is the last
+ * node visited one level above it, whose left child is filled first.
+ */
+void add_visited_node(std::vector<visited_node> &nodes,
+                      std::vector<int32_t> &path, visited_node node) {
+
+    int32_t i = nodes.size();
+    if (node.level > 0) {
+        visited_node &parent = nodes[path[node.level - 1]];
+        if (parent.left < 0)
+            parent.left = i;
+        else
+            parent.right = i;
+    }
+    path.resize(node.level + 1);
+    path[node.level] = i;
+    nodes.push_back(node);
+
+}
+
+
+class flat_clsf_visitor : public dtu::classification::TreeNodeVisitor {
+
+    public:
+        std::vector<visited_node> nodes;
+        size_t n_classes;
+
+        flat_clsf_visitor(size_t n_classes) : n_classes(n_classes) {}
+
+        bool onLeafNode(
+                const dtu::classification::LeafNodeDescriptor &desc) override {
+
+            visited_node node;
+            node.level = desc.level;
+            node.leaf = true;
+            // Weighted voting sums class probabilities of leaves, and
+            // unweighted voting their labels
+            node.values.assign(n_classes, 0.f);
+            if (desc.prob) {
+                for (size_t c = 0; c < n_classes; c++)
+                    node.values[c] = desc.prob[c];
+            } else {
+                node.values[desc.label] = 1.f;
+            }
+            add_visited_node(nodes, path, node);
+            return true;
+
+        }
+
+        bool onSplitNode(const dtu::SplitNodeDescriptor &desc) override {
+
+            visited_node node;
+            node.level = desc.level;
+            node.leaf = false;
+            node.feature = desc.featureIndex;
+            node.threshold = desc.featureValue;
+            add_visited_node(nodes, path, node);
+            return true;
+
+        }
+
+    private:
+        std::vector<int32_t> path;
+
+};
+
+
+class flat_regr_visitor : public dtu::regression::TreeNodeVisitor {
+
+    public:
+        std::vector<visited_node> nodes;
+
+        bool onLeafNode(
+                const dtu::regression::LeafNodeDescriptor &desc) override {
+
+            visited_node node;
+            node.level = desc.level;
+            node.leaf = true;
+            node.values.assign(1, desc.response);
+            add_visited_node(nodes, path, node);
+            return true;
+
+        }
+
+        bool onSplitNode(const dtu::SplitNodeDescriptor &desc) override {
+
+            visited_node node;
+            node.level = desc.level;
+            node.leaf = false;
+            node.feature = desc.featureIndex;
+            node.threshold = desc.featureValue;
+            add_visited_node(nodes, path, node);
+            return true;
+
+        }
+
+    private:
+        std::vector<int32_t> path;
+
+};
+
+
+/*
+ * Append a tree visited by DAAL to the flat forest in breadth-first order.
+ */
+void append_flat_tree(flat_forest &forest,
+                      const std::vector<visited_node> &nodes) {
+
+    int32_t base = forest.feature.size();
+    forest.root.push_back(base);
+    size_t depth = 0;
+
+    // order[k] is the visited node placed at index base + k
+    std::vector<int32_t> order(1, 0);
+    order.reserve(nodes.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        const visited_node &node = nodes[order[k]];
+        depth = std::max(depth, node.level);
+        if (node.leaf) {
+            forest.feature.push_back(0);
+            forest.threshold.push_back(
+                    std::numeric_limits<float>::infinity());
+            forest.left.push_back(base + k);
+            forest.value.push_back(forest.leaf_values.size());
+            forest.leaf_values.insert(forest.leaf_values.end(),
+                                      node.values.begin(), node.values.end());
+        } else {
+            forest.feature.push_back(node.feature);
+            forest.threshold.push_back(node.threshold);
+            forest.left.push_back(base + order.size());
+            forest.value.push_back(0);
+            order.push_back(node.left);
+            order.push_back(node.right);
+        }
+    }
+
+    forest.depth.push_back(depth);
+
+}
+
+
+flat_forest flatten_forest(dfc::ModelPtr model, size_t n_classes) {
+
+    flat_forest forest;
+    forest.n_outputs = n_classes;
+    forest.classification = true;
+    for (size_t t = 0; t < model->getNumberOfTrees(); t++) {
+        flat_clsf_visitor visitor(n_classes);
+        model->traverseDFS(t, visitor);
+        append_flat_tree(forest, visitor.nodes);
+    }
+    return forest;
+
+}
+
+
+flat_forest flatten_forest(dfr::ModelPtr model) {
+
+    flat_forest forest;
+    forest.n_outputs = 1;
+    forest.classification = false;
+    for (size_t t = 0; t < model->getNumberOfTrees(); t++) {
+        flat_regr_visitor visitor;
+        model->traverseDFS(t, visitor);
+        append_flat_tree(forest, visitor.nodes);
+    }
+    return forest;
+
+}
+
+
+/*
+ * Predict class labels (classification) or responses (regression) of the
+ * rows of X with a flat forest.
+ */
+dm::NumericTablePtr flat_forest_predict(const flat_forest &forest,
+                                        dm::NumericTablePtr X_nt) {
+
+    size_t n_rows = X_nt->getNumberOfRows();
+    size_t n_cols = X_nt->getNumberOfColumns();
+    dm::BlockDescriptor<double> block;
+    X_nt->getBlockOfRows(0, n_rows, dm::readOnly, block);
+    const double *X = block.getBlockPtr();
+
+    auto Y_nt = dm::HomogenNumericTable<double>::create(
+            1, n_rows, dm::NumericTable::doAllocate);
+    double *Y = Y_nt->getArray();
+
+    const int32_t *feature = forest.feature.data();
+    const float *threshold = forest.threshold.data();
+    const int32_t *left = forest.left.data();
+    const int32_t *value = forest.value.data();
+    const float *leaf_values = forest.leaf_values.data();
+    size_t n_outputs = forest.n_outputs;
+    size_t n_trees = forest.root.size();
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n_rows,
+                                                 FLAT_FOREST_BLOCK),
+        [&](const tbb::blocked_range<size_t> &r) {
+            std::vector<float> sums((r.end() - r.begin()) * n_outputs, 0.f);
+
+            for (size_t t = 0; t < n_trees; t++) {
+                for (size_t g = r.begin(); g < r.end();
+                     g += FLAT_FOREST_LANES) {
+                    size_t lanes = std::min((size_t) FLAT_FOREST_LANES,
+                                            r.end() - g);
+                    const double *x = X + g * n_cols;
+                    int32_t node[FLAT_FOREST_LANES];
+                    for (size_t l = 0; l < lanes; l++)
+                        node[l] = forest.root[t];
+
+                    for (int32_t d = 0; d < forest.depth[t]; d++) {
+                        for (size_t l = 0; l < lanes; l++) {
+                            int32_t i = node[l];
+                            float v = x[l * n_cols + feature[i]];
+                            node[l] = left[i] + (v > threshold[i]);
+                        }
+                    }
+
+                    float *s = sums.data() + (g - r.begin()) * n_outputs;
+                    for (size_t l = 0; l < lanes; l++) {
+                        const float *leaf = leaf_values + value[node[l]];
+                        for (size_t k = 0; k < n_outputs; k++)
+                            s[l * n_outputs + k] += leaf[k];
+                    }
+                }
+            }
+
+            for (size_t i = r.begin(); i < r.end(); i++) {
+                const float *s = sums.data() + (i - r.begin()) * n_outputs;
+                if (forest.classification)
+                    Y[i] = std::max_element(s, s + n_outputs) - s;
+                else
+                    Y[i] = s[0] / n_trees;
+            }
+        });
+
+    X_nt->releaseBlockOfRows(block);
+    return Y_nt;
+
+}
+
+
+/*
+ * Largest absolute difference between two single column tables.
+ */
+double max_abs_difference(dm::NumericTablePtr y1, dm::NumericTablePtr y2) {
+
+    size_t n_rows = std::min(y1->getNumberOfRows(), y2->getNumberOfRows());
+    dm::BlockDescriptor<double> block1, block2;
+    y1->getBlockOfRows(0, n_rows, dm::readOnly, block1);
+    y2->getBlockOfRows(0, n_rows, dm::readOnly, block2);
+    const double *p1 = block1.getBlockPtr(), *p2 = block2.getBlockPtr();
+
+    double diff = 0.;
+    for (size_t i = 0; i < n_rows; i++)
+        diff = std::max(diff, std::abs(p1[i] - p2[i]));
+
+    y1->releaseBlockOfRows(block1);
+    y2->releaseBlockOfRows(block2);
+    return diff;
+
+}
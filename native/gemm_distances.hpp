@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native distance kernels built on blocked MKL GEMM, benchmarked against
+ * DAAL's KMeans assignment and cosine and correlation distances with
+ * --gemm.
+ *
+ * Squared Euclidean distances are |x|^2 + |c|^2 - 2 x.c, and cosine and
+ * correlation distances are 1 - x.y of normalized (and, for correlation,
+ * centered) rows, so the bulk of the work is a GEMM. Output is split into
+ * tiles small enough for a tile of GEMM results to stay in cache, and
+ * each TBB task runs a sequential GEMM for its tile and then reduces it
+ * while it is still in cache: to the nearest centroid of each row for
+ * assignment, or to distances for pairwise matrices.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/blocked_range2d.h"
+#include "mkl.h"
+
+#include "daal.h"
+#include "common.hpp"
+
+namespace dm = daal::data_management;
+
+// Rows of X in a tile
+#define GEMM_TILE_ROWS 256
+// Centroids or rows of Y in a tile: 256 x 256 doubles fit in L2
+#define GEMM_TILE_COLS 256
+
+
+/*
+ * Run a GEMM on one thread from a TBB task, so MKL doesn't start its own
+ * threads under ours.
+ */
+class mkl_sequential_scope {
+
+    public:
+        mkl_sequential_scope() : previous(mkl_set_num_threads_local(1)) {}
+        ~mkl_sequential_scope() { mkl_set_num_threads_local(previous); }
+
+    private:
+        int previous;
+
+};
+
+
+/*
+ * C (m x n) = alpha A B^T for row-major A (m x d) and B (n x d).
+ */
+void gemm_abt(const double *A, const double *B, double *C, size_t m,
+              size_t n, size_t d, double alpha, size_t ldc) {
+
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, n, d, alpha,
+                A, d, B, d, 0., C, ldc);
+
+}
+
+
+void squared_norms(const double *X, size_t n, size_t d, double *norms) {
+
+    tbb::parallel_for(size_t(0), n, [&](size_t i) {
+        double s = 0.;
+        for (size_t j = 0; j < d; j++)
+            s += X[i * d + j] * X[i * d + j];
+        norms[i] = s;
+    });
+
+}
+
+
+/*
+ * Index of the nearest of the k x d centroids C to each of the n x d rows
+ * of X, and optionally its squared distance.
+ */
+void gemm_assign(const double *X, size_t n, const double *C, size_t k,
+                 size_t d, int *assignments, double *distances = nullptr) {
+
+    std::vector<double> x_norms(n), c_norms(k);
+    squared_norms(X, n, d, x_norms.data());
+    squared_norms(C, k, d, c_norms.data());
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n, GEMM_TILE_ROWS),
+        [&](const tbb::blocked_range<size_t> &r) {
+            mkl_sequential_scope sequential;
+            size_t m = r.end() - r.begin();
+            std::vector<double> tile(m * GEMM_TILE_COLS);
+            std::vector<double> best(m, std::numeric_limits<double>::max());
+            std::vector<int> best_c(m, 0);
+
+            for (size_t c0 = 0; c0 < k; c0 += GEMM_TILE_COLS) {
+                size_t kc = std::min((size_t) GEMM_TILE_COLS, k - c0);
+                gemm_abt(X + r.begin() * d, C + c0 * d, tile.data(), m, kc,
+                         d, -2., GEMM_TILE_COLS);
+
+                // |x|^2 is the same for all centroids of a row, so it is
+                // only added to the minimum
+                for (size_t i = 0; i < m; i++) {
+                    const double *t = tile.data() + i * GEMM_TILE_COLS;
+                    for (size_t c = 0; c < kc; c++) {
+                        double dist = t[c] + c_norms[c0 + c];
+                        if (dist < best[i]) {
+                            best[i] = dist;
+                            best_c[i] = c0 + c;
+                        }
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < m; i++) {
+                assignments[r.begin() + i] = best_c[i];
+                if (distances) {
+                    distances[r.begin() + i] = std::max(
+                            best[i] + x_norms[r.begin() + i], 0.);
+                }
+            }
+        });
+
+}
+
+
+dm::NumericTablePtr gemm_assign(dm::NumericTablePtr X_nt,
+                                dm::NumericTablePtr C_nt) {
+
+    size_t n = X_nt->getNumberOfRows(), d = X_nt->getNumberOfColumns();
+    size_t k = C_nt->getNumberOfRows();
+    dm::BlockDescriptor<double> block_X, block_C;
+    X_nt->getBlockOfRows(0, n, dm::readOnly, block_X);
+    C_nt->getBlockOfRows(0, k, dm::readOnly, block_C);
+
+    auto assignments_nt = dm::HomogenNumericTable<int>::create(
+            1, n, dm::NumericTable::doAllocate);
+    gemm_assign(block_X.getBlockPtr(), n, block_C.getBlockPtr(), k, d,
+                assignments_nt->getArray());
+
+    C_nt->releaseBlockOfRows(block_C);
+    X_nt->releaseBlockOfRows(block_X);
+    return assignments_nt;
+
+}
+
+
+/*
+ * 1 - x.y for all pairs of rows of the n x d matrix X, whose rows are
+ * normalized, in tiles of the upper triangle mirrored to the lower one.
+ */
+dm::NumericTablePtr gemm_pairwise_distances(const std::vector<double> &X,
+                                            size_t n, size_t d) {
+
+    auto D_nt = dm::HomogenNumericTable<double>::create(
+            n, n, dm::NumericTable::doAllocate);
+    double *D = D_nt->getArray();
+
+    size_t n_tiles = (n + GEMM_TILE_ROWS - 1) / GEMM_TILE_ROWS;
+    tbb::parallel_for(tbb::blocked_range2d<size_t>(0, n_tiles, 1,
+                                                   0, n_tiles, 1),
+        [&](const tbb::blocked_range2d<size_t> &r) {
+            mkl_sequential_scope sequential;
+            std::vector<double> tile(GEMM_TILE_ROWS * GEMM_TILE_ROWS);
+            for (size_t ti = r.rows().begin(); ti < r.rows().end(); ti++) {
+                for (size_t tj = r.cols().begin(); tj < r.cols().end();
+                     tj++) {
+                    if (tj < ti)
+                        continue;
+                    size_t i0 = ti * GEMM_TILE_ROWS, j0 = tj * GEMM_TILE_ROWS;
+                    size_t mi = std::min((size_t) GEMM_TILE_ROWS, n - i0);
+                    size_t mj = std::min((size_t) GEMM_TILE_ROWS, n - j0);
+                    gemm_abt(X.data() + i0 * d, X.data() + j0 * d,
+                             tile.data(), mi, mj, d, 1., GEMM_TILE_ROWS);
+                    for (size_t i = 0; i < mi; i++) {
+                        for (size_t j = 0; j < mj; j++) {
+                            double dist = 1. - tile[i * GEMM_TILE_ROWS + j];
+                            D[(i0 + i) * n + j0 + j] = dist;
+                            D[(j0 + j) * n + i0 + i] = dist;
+                        }
+                    }
+                }
+            }
+        });
+
+    return D_nt;
+
+}
+
+
+/*
+ * Copy of the rows of X, centered on their means if wanted, scaled to
+ * unit norm.
+ */
+std::vector<double> normalized_rows(const double *X, size_t n, size_t d,
+                                    bool center) {
+
+    std::vector<double> Xn(X, X + n * d);
+    tbb::parallel_for(size_t(0), n, [&](size_t i) {
+        double *x = Xn.data() + i * d;
+        if (center) {
+            double mean = 0.;
+            for (size_t j = 0; j < d; j++)
+                mean += x[j];
+            mean /= d;
+            for (size_t j = 0; j < d; j++)
+                x[j] -= mean;
+        }
+        double norm = 0.;
+        for (size_t j = 0; j < d; j++)
+            norm += x[j] * x[j];
+        norm = std::sqrt(norm);
+        if (norm > 0.) {
+            for (size_t j = 0; j < d; j++)
+                x[j] /= norm;
+        }
+    });
+    return Xn;
+
+}
+
+
+dm::NumericTablePtr gemm_cosine(const double *X, size_t n, size_t d) {
+
+    return gemm_pairwise_distances(normalized_rows(X, n, d, false), n, d);
+
+}
+
+
+dm::NumericTablePtr gemm_correlation(const double *X, size_t n, size_t d) {
+
+    return gemm_pairwise_distances(normalized_rows(X, n, d, true), n, d);
+
+}
+
+
+/*
+ * Largest absolute difference between two tables of the same shape, and
+ * the number of differing entries of integer tables.
+ */
+double max_table_difference(dm::NumericTablePtr a, dm::NumericTablePtr b,
+                            size_t *n_differ = nullptr) {
+
+    size_t n = std::min(a->getNumberOfRows(), b->getNumberOfRows());
+    size_t d = std::min(a->getNumberOfColumns(), b->getNumberOfColumns());
+    dm::BlockDescriptor<double> block_a, block_b;
+    a->getBlockOfRows(0, n, dm::readOnly, block_a);
+    b->getBlockOfRows(0, n, dm::readOnly, block_b);
+    const double *pa = block_a.getBlockPtr(), *pb = block_b.getBlockPtr();
+
+    double diff = 0.;
+    if (n_differ)
+        *n_differ = 0;
+    for (size_t i = 0; i < n * d; i++) {
+        double t = std::abs(pa[i] - pb[i]);
+        diff = std::max(diff, t);
+        if (n_differ && t != 0.)
+            (*n_differ)++;
+    }
+
+    a->releaseBlockOfRows(block_a);
+    b->releaseBlockOfRows(block_b);
+    return diff;
+
+}
+
+
+void print_gemm_comparison(const std::string &function, double flops,
+                           double time, double daal_time) {
+
+    std::cout << "@ " << function << ": " << flops / time * 1e-9
+              << " GFLOP/s in " << time * 1e3 << " ms, DAAL "
+              << flops / daal_time * 1e-9 << " GFLOP/s in "
+              << daal_time * 1e3 << " ms (" << daal_time / time
+              << "x speedup)" << std::endl;
+
+}
@@ -0,0 +1,695 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Hyperparameter search over a grid (or random sample of it) of forest,
+ * SVM or logistic regression parameters, comparing the naive loop of
+ * fits one after another with all threads to fits scheduled side by side.
+ *
+ * DAAL doesn't scale fits of small datasets to many threads, so the
+ * scheduler gives each fit a thread per --rows-per-thread rows of its
+ * training set, and runs as many streams of fits as that leaves threads
+ * for, each in its own tbb::task_arena. Streams take the next config
+ * when they are done with one, and TBB balances the work of each fit
+ * among the threads of its arena. With --halving, configs are raced by
+ * successive halving: all configs are fitted on a few rows, and only the
+ * best 1/eta of them go on to eta times as many rows, until one config is
+ * left or all rows are used. Small early rungs then get more, smaller
+ * streams.
+ *
+ * Configs are scored on the last --validation rows, and fitted on the
+ * first rows of the others. Each search reports its wall time, and core
+ * utilization as the CPU time of the process over wall time and threads.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "tbb/task_arena.h"
+
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "cv.hpp"
+#include "decision_forest_clsf.hpp"
+#include "log_reg_lbfgs.hpp"
+#include "svm.hpp"
+
+
+/*
+ * A hyperparameter and the values to search.
+ */
+struct search_dim {
+    std::string name;
+    std::vector<double> values;
+};
+
+
+typedef std::vector<double> search_config;  // A value of each dimension
+
+
+/*
+ * Parse a --space dimension of the form name=v1,v2,...
+ */
+bool parse_search_dim(const std::string &arg, struct search_dim &dim) {
+
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos || eq == 0) {
+        std::cerr << "error: --space wants name=v1,v2,... but got '"
+                  << arg << "'" << std::endl;
+        return false;
+    }
+    dim.name = arg.substr(0, eq);
+    dim.values.clear();
+    std::istringstream values(arg.substr(eq + 1));
+    std::string value;
+    while (std::getline(values, value, ',')) {
+        try {
+            dim.values.push_back(std::stod(value));
+        } catch (const std::exception &) {
+            std::cerr << "error: bad value '" << value << "' of "
+                      << dim.name << " in --space" << std::endl;
+            return false;
+        }
+    }
+    if (dim.values.empty()) {
+        std::cerr << "error: no values of " << dim.name << " in --space"
+                  << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+
+/*
+ * All configs of the grid, or n_random of them drawn without replacement
+ * if n_random is not zero.
+ */
+std::vector<search_config> search_configs(
+        const std::vector<search_dim> &dims, size_t n_random,
+        unsigned seed) {
+
+    std::vector<search_config> configs(1);
+    for (auto &dim : dims) {
+        std::vector<search_config> next;
+        for (auto &config : configs) {
+            for (double value : dim.values) {
+                next.push_back(config);
+                next.back().push_back(value);
+            }
+        }
+        configs.swap(next);
+    }
+
+    if (n_random > 0 && n_random < configs.size()) {
+        std::mt19937 rng(seed);
+        std::shuffle(configs.begin(), configs.end(), rng);
+        configs.resize(n_random);
+    }
+    return configs;
+
+}
+
+
+/*
+ * Why v isn't a valid value of the named hyperparameter on data with
+ * n_features features, or an empty string if it is.
+ */
+std::string search_value_error(const std::string &name, double v,
+                               size_t n_features) {
+
+    bool integer = name == "n_trees" || name == "max_depth"
+                   || name == "features_per_node" || name == "min_leaf"
+                   || name == "max_leaf_nodes" || name == "max_iter";
+    if (integer && v != std::floor(v))
+        return "must be an integer";
+
+    if (name == "n_trees" || name == "min_leaf" || name == "max_iter") {
+        if (v < 1.)
+            return "must be at least 1";
+    } else if (name == "max_depth" || name == "max_leaf_nodes") {
+        if (v < 0.)
+            return "can't be negative";
+    } else if (name == "features_per_node") {
+        if (v < 0. || v > n_features) {
+            std::ostringstream s;
+            s << "must be from 0 (the default) to the " << n_features
+              << " features";
+            return s.str();
+        }
+    } else if (name == "samples_fraction") {
+        if (v <= 0. || v > 1.)
+            return "must be in (0, 1]";
+    } else if (v <= 0.) {
+        // C, gamma and tol
+        return "must be positive";
+    }
+    return "";
+
+}
+
+
+std::string config_string(const std::vector<search_dim> &dims,
+                          const search_config &config) {
+
+    std::ostringstream s;
+    for (size_t i = 0; i < dims.size(); i++)
+        s << (i == 0 ? "" : " ") << dims[i].name << '=' << config[i];
+    return s.str();
+
+}
+
+
+/*
+ * Threads to give a fit on n_rows rows: one per rows_per_thread rows, so
+ * small fits run side by side instead of on threads they can't use.
+ */
+int search_fit_threads(size_t n_rows, size_t rows_per_thread,
+                       int n_threads) {
+
+    size_t threads = (n_rows + rows_per_thread - 1) / rows_per_thread;
+    return (int) std::max(std::min(threads, (size_t) n_threads),
+                          (size_t) 1);
+
+}
+
+
+struct search_result {
+    double time;          // Wall time in seconds
+    double cpu_time;      // CPU time of the process in seconds
+    size_t fits;
+    size_t best;          // Index of the best config
+    double best_score;
+};
+
+
+/*
+ * Fit and score the given configs on the first n_rows training rows with
+ * fit_score(config index, n_rows), in streams of fit_threads threads
+ * (or more, if there are fewer configs than streams). Returns the score
+ * of each config. If a fit throws, the other streams stop taking configs
+ * and the exception is rethrown here.
+ */
+template <typename FitScore>
+std::vector<double> search_streams(const std::vector<size_t> &configs,
+                                   size_t n_rows, int fit_threads,
+                                   int n_threads, FitScore &fit_score) {
+
+    int n_streams = std::min(std::max(n_threads / fit_threads, 1),
+                             (int) configs.size());
+    int stream_threads = std::max(n_threads / n_streams, 1);
+    std::vector<double> scores(configs.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(n_streams);
+
+    std::vector<std::thread> streams;
+    for (int i = 0; i < n_streams; i++) {
+        streams.emplace_back([&, i] {
+            tbb::task_arena arena(stream_threads);
+            for (size_t c = next++; c < configs.size(); c = next++) {
+                try {
+                    arena.execute([&] {
+                        scores[c] = fit_score(configs[c], n_rows);
+                    });
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                    next = configs.size();
+                }
+            }
+        });
+    }
+    for (auto &stream : streams)
+        stream.join();
+    for (auto &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    return scores;
+
+}
+
+
+struct search_options {
+    std::vector<std::string> space;  // name=v1,v2,... of each dimension
+    size_t random;           // Configs to draw from the grid, 0 for all
+    unsigned seed;
+    double validation;       // Fraction of rows to score configs on
+    size_t rows_per_thread;  // Training rows per thread of a fit
+    bool halving;            // Also search by successive halving
+    size_t eta;              // Halving keeps 1/eta of configs per rung
+    size_t min_rows;         // Training rows of the first rung, at least
+    bool skip_sequential;    // Don't run the naive loop
+};
+
+
+void add_search_args(CLI::App &app, struct search_options &opts) {
+
+    app.add_option("--space", opts.space,
+                   "Values of each hyperparameter to search, as "
+                   "name=v1,v2,...")
+        ->required();
+
+    opts.random = 0;
+    app.add_option("--random", opts.random,
+                   "Search this many configs drawn at random from the "
+                   "grid (0: the whole grid)", true);
+
+    opts.seed = 777;
+    app.add_option("--search-seed", opts.seed,
+                   "Seed for drawing configs", true);
+
+    opts.validation = 0.2;
+    app.add_option("--validation", opts.validation,
+                   "Fraction of rows (the last ones) to score configs on",
+                   true)
+        ->check(CLI::Range(0.01, 0.9));
+
+    opts.rows_per_thread = 10000;
+    app.add_option("--rows-per-thread", opts.rows_per_thread,
+                   "Training rows per thread of a fit in concurrent "
+                   "searches", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.halving = false;
+    app.add_flag("--halving", opts.halving,
+                 "Also search by successive halving, fitting all configs "
+                 "on a few rows and only the best on more");
+
+    opts.eta = 3;
+    app.add_option("--eta", opts.eta,
+                   "Successive halving keeps the best 1/eta of configs, "
+                   "and fits them on eta times as many rows", true)
+        ->check(CLI::Range(2, 100));
+
+    opts.min_rows = 1000;
+    app.add_option("--min-rows", opts.min_rows,
+                   "Least training rows of the first halving rung", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.skip_sequential = false;
+    app.add_flag("--skip-sequential", opts.skip_sequential,
+                 "Don't run the naive loop of fits with all threads");
+
+}
+
+
+template <typename FitScore>
+struct search_result search_sequential(size_t n_configs, size_t n_rows,
+                                       FitScore &fit_score) {
+
+    struct search_result result = {0., 0., 0, 0, 0.};
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = process_cpu_time();
+    for (size_t c = 0; c < n_configs; c++) {
+        double score = fit_score(c, n_rows);
+        if (c == 0 || score > result.best_score) {
+            result.best = c;
+            result.best_score = score;
+        }
+    }
+    result.time = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    result.cpu_time = process_cpu_time() - cpu_start;
+    result.fits = n_configs;
+    return result;
+
+}
+
+
+template <typename FitScore>
+struct search_result search_concurrent(size_t n_configs, size_t n_rows,
+                                       const struct search_options &opts,
+                                       int n_threads, FitScore &fit_score) {
+
+    struct search_result result = {0., 0., 0, 0, 0.};
+    std::vector<size_t> configs(n_configs);
+    for (size_t c = 0; c < n_configs; c++)
+        configs[c] = c;
+
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = process_cpu_time();
+    int fit_threads = search_fit_threads(n_rows, opts.rows_per_thread,
+                                         n_threads);
+    auto scores = search_streams(configs, n_rows, fit_threads, n_threads,
+                                 fit_score);
+    result.time = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    result.cpu_time = process_cpu_time() - cpu_start;
+
+    result.best = std::max_element(scores.begin(), scores.end())
+                  - scores.begin();
+    result.best_score = scores[result.best];
+    result.fits = n_configs;
+    return result;
+
+}
+
+
+/*
+ * Successive halving of the configs over rungs of eta times as many
+ * training rows, ending with all n_rows rows.
+ */
+template <typename FitScore>
+struct search_result search_halving(size_t n_configs, size_t n_rows,
+                                    const struct search_options &opts,
+                                    int n_threads, FitScore &fit_score,
+                                    const std::string &function,
+                                    bool verbose) {
+
+    struct search_result result = {0., 0., 0, 0, 0.};
+    std::vector<size_t> alive(n_configs);
+    for (size_t c = 0; c < n_configs; c++)
+        alive[c] = c;
+
+    // Enough rungs to get down to one config
+    size_t n_rungs = 1;
+    for (size_t n = n_configs; n > 1; n = (n + opts.eta - 1) / opts.eta)
+        n_rungs++;
+    double rows = n_rows;
+    for (size_t r = 1; r < n_rungs; r++)
+        rows /= opts.eta;
+
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = process_cpu_time();
+    for (size_t rung = 0; ; rung++) {
+        size_t rung_rows = std::min(std::max((size_t) rows, opts.min_rows),
+                                    n_rows);
+        int fit_threads = search_fit_threads(rung_rows,
+                                             opts.rows_per_thread,
+                                             n_threads);
+        auto rung_start = std::chrono::steady_clock::now();
+        auto scores = search_streams(alive, rung_rows, fit_threads,
+                                     n_threads, fit_score);
+        result.fits += alive.size();
+
+        // Order configs by score, best first
+        std::vector<size_t> order(alive.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a,
+                                                         size_t b) {
+            return scores[a] > scores[b];
+        });
+        result.best = alive[order[0]];
+        result.best_score = scores[order[0]];
+
+        if (verbose) {
+            std::cout << "@ " << function << " rung " << rung << ": "
+                      << alive.size() << " configs on " << rung_rows
+                      << " rows, " << fit_threads << " threads per fit, "
+                      << "best score " << result.best_score << " in "
+                      << std::chrono::duration<double>(
+                             std::chrono::steady_clock::now()
+                             - rung_start).count() * 1e3
+                      << " ms" << std::endl;
+        }
+        if (alive.size() == 1 || rung_rows == n_rows)
+            break;
+
+        std::vector<size_t> keep;
+        size_t n_keep = (alive.size() + opts.eta - 1) / opts.eta;
+        for (size_t i = 0; i < n_keep; i++)
+            keep.push_back(alive[order[i]]);
+        alive.swap(keep);
+        rows *= opts.eta;
+    }
+    result.time = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    result.cpu_time = process_cpu_time() - cpu_start;
+    return result;
+
+}
+
+
+struct hyper_search_bench {
+
+    static const char *description() {
+        return "Native benchmark of hyperparameter search with concurrent "
+               "Intel(R) DAAL fits";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,model,configs,function,"
+               "fits,best_score,utilization,time";
+    }
+
+    std::string xfn, yfn;
+    std::string model_name = "df_clsf";
+    struct search_options opts;
+
+    df_clsf_bench df_clsf;
+    log_reg_lbfgs_bench log_reg;
+    svm_bench svm;
+
+    std::vector<search_dim> dims;
+    std::vector<search_config> configs;
+    dm::NumericTablePtr X_nt, Y_nt, X_val, Y_val;
+    size_t n_train;
+    int n_threads;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-x,--fileX,--file-X-train", xfn, "Feature file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        app.add_option("-y,--fileY,--file-y-train", yfn, "Labels file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        app.add_option("--model", model_name, "Model to search", true)
+            ->check(CLI::IsMember({"df_clsf", "log_reg", "svm"}));
+
+        add_search_args(app, opts);
+
+        // Parameters not in --space keep their benchmarks' defaults
+        CLI::App model_app;
+        df_clsf.add_args(model_app);
+        log_reg.add_args(model_app);
+        svm.add_args(model_app);
+
+    }
+
+    /*
+     * Names of the hyperparameters of the model which can be searched.
+     */
+    std::vector<std::string> dim_names() const {
+
+        if (model_name == "df_clsf")
+            return {"n_trees", "max_depth", "features_per_node",
+                    "min_leaf", "max_leaf_nodes", "samples_fraction"};
+        if (model_name == "svm")
+            return {"C", "gamma", "tol"};
+        return {"C", "tol", "max_iter"};
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        n_threads = ctx.daal_threads;
+        auto names = dim_names();
+        for (auto &arg : opts.space) {
+            struct search_dim dim;
+            if (!parse_search_dim(arg, dim))
+                return false;
+            if (std::find(names.begin(), names.end(), dim.name)
+                == names.end()) {
+                std::cerr << "error: " << model_name << " has no "
+                          << "hyperparameter " << dim.name << " (it has";
+                for (auto &name : names)
+                    std::cerr << ' ' << name;
+                std::cerr << ')' << std::endl;
+                return false;
+            }
+            dims.push_back(dim);
+        }
+        configs = search_configs(dims, opts.random, opts.seed);
+
+        if (model_name == "df_clsf") {
+            df_clsf.xfn = xfn;
+            df_clsf.yfn = yfn;
+            if (!df_clsf.load(ctx))
+                return false;
+            X_nt = df_clsf.X_nt;
+            Y_nt = df_clsf.Y_nt;
+        } else if (model_name == "log_reg") {
+            log_reg.xfn = xfn;
+            log_reg.yfn = yfn;
+            if (!log_reg.load(ctx))
+                return false;
+            X_nt = log_reg.X_nt;
+            Y_nt = log_reg.Y_nt;
+        } else {
+            svm.xfn = xfn;
+            svm.yfn = yfn;
+            if (!svm.load(ctx))
+                return false;
+            X_nt = svm.X_nt;
+            Y_nt = svm.Y_nt;
+        }
+
+        // Bad values would only fail in DAAL, in the middle of a search
+        size_t n_features = X_nt->getNumberOfColumns();
+        for (auto &dim : dims) {
+            for (double v : dim.values) {
+                std::string error = search_value_error(dim.name, v,
+                                                       n_features);
+                if (!error.empty()) {
+                    std::cerr << "error: " << dim.name << " " << error
+                              << " but --space has " << v << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        size_t n_rows = X_nt->getNumberOfRows();
+        n_train = n_rows - (size_t) (n_rows * opts.validation);
+        X_val = table_rows(X_nt, n_train, n_rows, false);
+        Y_val = table_rows(Y_nt, n_train, n_rows, false);
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {
+        os << model_name << ',' << configs.size() << ',';
+    }
+
+    /*
+     * Fit the model with the given config on the first n_rows training
+     * rows, returning its accuracy on the validation rows.
+     */
+    double fit_score(const search_config &config, size_t n_rows) {
+
+        dm::NumericTablePtr X = table_rows(X_nt, 0, n_rows, false);
+        dm::NumericTablePtr Y = table_rows(Y_nt, 0, n_rows, false);
+        dm::NumericTablePtr Yp;
+
+        if (model_name == "df_clsf") {
+            struct df_params params = df_clsf.params;
+            for (size_t i = 0; i < dims.size(); i++) {
+                double v = config[i];
+                if (dims[i].name == "n_trees")
+                    params.n_trees = v;
+                else if (dims[i].name == "max_depth")
+                    params.max_depth = v;
+                else if (dims[i].name == "features_per_node")
+                    params.features_per_node = v;
+                else if (dims[i].name == "min_leaf")
+                    params.min_leaf = v;
+                else if (dims[i].name == "max_leaf_nodes")
+                    params.max_leaf_nodes = v;
+                else
+                    params.samples_fraction = v;
+            }
+            int n_classes = df_clsf.n_classes;
+            auto r = df_classification_fit(n_classes, params, X, Y, false);
+            Yp = df_classification_predict(n_classes, r, X_val, false);
+        } else if (model_name == "svm") {
+            svm_params params = svm.params;
+            for (size_t i = 0; i < dims.size(); i++) {
+                double v = config[i];
+                if (dims[i].name == "C")
+                    params.C = v;
+                else if (dims[i].name == "gamma")
+                    params.gamma = v;
+                else
+                    params.tol = v;
+            }
+            da::classifier::training::ResultPtr r;
+            std::tie(r, std::ignore) = svm_fit(params, X, Y, svm.n_classes,
+                                               false);
+            Yp = svm_predict(params, r, X_val, svm.n_classes, false);
+        } else {
+            double C = log_reg.C, tol = log_reg.tol;
+            size_t max_iter = log_reg.max_iter;
+            for (size_t i = 0; i < dims.size(); i++) {
+                double v = config[i];
+                if (dims[i].name == "C")
+                    C = v;
+                else if (dims[i].name == "tol")
+                    tol = v;
+                else
+                    max_iter = v;
+            }
+            int n_classes = log_reg.n_classes;
+            auto r = logistic_regression_fit(n_classes,
+                                             log_reg.fit_intercept, C,
+                                             max_iter, tol, X, Y, false);
+            Yp = logistic_regression_predict(n_classes, r, X_val, false);
+        }
+        return accuracy_score(Y_val, Yp) * 100.;
+
+    }
+
+    void report(bench_runner &runner, const std::string &function,
+                const struct search_result &r) {
+
+        double utilization = r.cpu_time / (r.time * n_threads) * 100.;
+        if (runner.verbose()) {
+            std::cout << "@ " << function << ": best "
+                      << config_string(dims, configs[r.best]) << " with "
+                      << r.best_score << "% accuracy, " << r.fits
+                      << " fits, " << utilization << "% core utilization"
+                      << std::endl;
+        }
+        runner.report_measured(function, r.time, r.fits, r.best_score,
+                               utilization);
+
+    }
+
+    void run(bench_runner &runner) {
+
+        auto by_index = [&](size_t c, size_t n_rows) {
+            return fit_score(configs[c], n_rows);
+        };
+        std::string prefix = model_name + ".search";
+
+        // One untimed fit, so initialization isn't measured
+        fit_score(configs[0], std::min(n_train, opts.min_rows));
+
+        double sequential_time = 0.;
+        if (!opts.skip_sequential) {
+            auto r = search_sequential(configs.size(), n_train, by_index);
+            report(runner, prefix + "_sequential", r);
+            sequential_time = r.time;
+        }
+
+        auto r = search_concurrent(configs.size(), n_train, opts,
+                                   n_threads, by_index);
+        report(runner, prefix + "_concurrent", r);
+        if (runner.verbose() && sequential_time > 0.) {
+            std::cout << "@ " << prefix << "_concurrent: "
+                      << sequential_time / r.time << "x the speed of "
+                      << "sequential fits" << std::endl;
+        }
+
+        if (opts.halving) {
+            r = search_halving(configs.size(), n_train, opts, n_threads,
+                               by_index, prefix + "_halving",
+                               runner.verbose());
+            report(runner, prefix + "_halving", r);
+            if (runner.verbose() && sequential_time > 0.) {
+                std::cout << "@ " << prefix << "_halving: "
+                          << sequential_time / r.time << "x the speed of "
+                          << "sequential fits" << std::endl;
+            }
+        }
+
+    }
+
+};
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "hyper_search.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    return run_benchmark<hyper_search_bench>(argc, argv);
+
+}
@@ -0,0 +1,269 @@
+/*
+ * json.hpp
+ * a small implementation of reading JSON documents, such as the
+ * benchmark configuration files used by runner.py.
+ *
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+struct json_value {
+
+    enum kind_t { null_kind, bool_kind, number_kind, string_kind,
+                  array_kind, object_kind };
+
+    kind_t kind = null_kind;
+    bool boolean = false;
+    double number = 0.;
+    std::string string;
+    std::vector<json_value> array;
+    /* keep members in document order, like python's json module */
+    std::vector<std::pair<std::string, json_value>> object;
+
+    bool is_null() const { return kind == null_kind; }
+    bool is_array() const { return kind == array_kind; }
+    bool is_object() const { return kind == object_kind; }
+
+    bool has(const std::string &key) const {
+        for (auto &member : object)
+            if (member.first == key)
+                return true;
+        return false;
+    }
+
+    /* Object member lookup. Missing keys give a null value. */
+    const json_value &operator[](const std::string &key) const {
+        static const json_value null_value;
+        for (auto &member : object)
+            if (member.first == key)
+                return member.second;
+        return null_value;
+    }
+
+    /*
+     * Format a scalar the way python's str() would, so that values can be
+     * passed on the command line as runner.py does.
+     */
+    std::string to_string() const {
+        switch (kind) {
+            case bool_kind:
+                return boolean ? "True" : "False";
+            case number_kind: {
+                char buf[32];
+                snprintf(buf, sizeof(buf), "%.15g", number);
+                return buf;
+            }
+            case string_kind:
+                return string;
+            default:
+                return "";
+        }
+    }
+
+};
+
+
+class json_parser {
+
+    public:
+        json_parser(const std::string &text) : text(text), pos(0) {}
+
+        json_value parse() {
+            json_value value = parse_value();
+            skip_whitespace();
+            if (pos != text.size())
+                fail("trailing characters");
+            return value;
+        }
+
+    private:
+        const std::string &text;
+        size_t pos;
+
+        void fail(const std::string &what) {
+            throw std::runtime_error("JSON parse error at offset "
+                                     + std::to_string(pos) + ": " + what);
+        }
+
+        void skip_whitespace() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'
+                   || text[pos] == '\n' || text[pos] == '\r'))
+                pos++;
+        }
+
+        char peek() {
+            skip_whitespace();
+            if (pos >= text.size())
+                fail("unexpected end of input");
+            return text[pos];
+        }
+
+        void expect(char c) {
+            if (peek() != c)
+                fail(std::string("expected '") + c + '\'');
+            pos++;
+        }
+
+        bool consume_literal(const char *literal) {
+            size_t len = strlen(literal);
+            if (text.compare(pos, len, literal) != 0)
+                return false;
+            pos += len;
+            return true;
+        }
+
+        json_value parse_value() {
+            json_value value;
+            char c = peek();
+
+            if (c == '{') {
+                value.kind = json_value::object_kind;
+                pos++;
+                if (peek() == '}') {
+                    pos++;
+                    return value;
+                }
+                do {
+                    if (peek() != '"')
+                        fail("expected object key");
+                    std::string key = parse_string();
+                    expect(':');
+                    value.object.emplace_back(key, parse_value());
+                } while (peek() == ',' && ++pos);
+                expect('}');
+            } else if (c == '[') {
+                value.kind = json_value::array_kind;
+                pos++;
+                if (peek() == ']') {
+                    pos++;
+                    return value;
+                }
+                do {
+                    value.array.push_back(parse_value());
+                } while (peek() == ',' && ++pos);
+                expect(']');
+            } else if (c == '"') {
+                value.kind = json_value::string_kind;
+                value.string = parse_string();
+            } else if (consume_literal("true")) {
+                value.kind = json_value::bool_kind;
+                value.boolean = true;
+            } else if (consume_literal("false")) {
+                value.kind = json_value::bool_kind;
+            } else if (consume_literal("null")) {
+                value.kind = json_value::null_kind;
+            } else {
+                const char *begin = text.c_str() + pos;
+                char *end;
+                value.kind = json_value::number_kind;
+                value.number = strtod(begin, &end);
+                if (end == begin)
+                    fail("unexpected character");
+                pos += end - begin;
+            }
+
+            return value;
+        }
+
+        std::string parse_string() {
+            std::string out;
+            expect('"');
+            while (pos < text.size() && text[pos] != '"') {
+                char c = text[pos++];
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos >= text.size())
+                    break;
+                c = text[pos++];
+                switch (c) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': {
+                        /* only code points below 0x80 show up in configs */
+                        unsigned long code = strtoul(
+                                text.substr(pos, 4).c_str(), NULL, 16);
+                        pos += 4;
+                        out += (char) (code < 0x80 ? code : '?');
+                        break;
+                    }
+                    default: out += c; break;
+                }
+            }
+            if (pos >= text.size())
+                fail("unterminated string");
+            pos++;
+            return out;
+        }
+
+};
+
+
+json_value parse_json(const std::string &text) {
+
+    return json_parser(text).parse();
+
+}
+
+
+/*
+ * Quote a string for output in a JSON document.
+ */
+std::string json_quote(const std::string &s) {
+
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if ((unsigned char) c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+    return out;
+
+}
+
+
+/*
+ * Read and parse a JSON file. Throws std::runtime_error on failure.
+ */
+json_value load_json(const std::string &path) {
+
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("failed to open " + path);
+
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    return parse_json(buffer.str());
+
+}
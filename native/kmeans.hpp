@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2017-2019 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#define DAAL_DATA_TYPE double
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "CLI11.hpp"
+#include "daal.h"
+#include "npyfile.h"
+#include "kmeans_bounds.hpp"
+#include "kmeans_minibatch.hpp"
+#include "gemm_distances.hpp"
+
+
+const size_t max_iters = 100;
+
+int kmeans_iterations(da::kmeans::ResultPtr kmeans_result) {
+
+    dm::NumericTablePtr nIterationsNumericTable
+        = kmeans_result->get(da::kmeans::nIterations);
+    dm::BlockDescriptor<int> blockNI;
+    nIterationsNumericTable->getBlockOfRows(0, 1, dm::readOnly, blockNI);
+    int *niPtr = blockNI.getBlockPtr();
+    int actual_iters = niPtr[0];
+    nIterationsNumericTable->releaseBlockOfRows(blockNI);
+
+    return actual_iters;
+
+}
+
+da::kmeans::ResultPtr
+kmeans_fit_test(dm::NumericTablePtr X_nt, dm::NumericTablePtr X_init_nt,
+                double tol, bool verbose) {
+
+    dm::NumericTablePtr seeding_centroids = X_init_nt;
+
+    int n_clusters = seeding_centroids->getNumberOfRows();
+    da::kmeans::Batch<double> algorithm(n_clusters, max_iters);
+    algorithm.input.set(da::kmeans::data, X_nt);
+    algorithm.input.set(da::kmeans::inputCentroids, seeding_centroids);
+    algorithm.parameter.assignFlag = true;
+    algorithm.parameter.accuracyThreshold = tol;
+    algorithm.compute();
+
+    da::kmeans::ResultPtr kmeans_result = algorithm.getResult();
+
+    kmeans_result->get(da::kmeans::assignments);
+    kmeans_result->get(da::kmeans::centroids  );
+    kmeans_result->get(da::kmeans::objectiveFunction);
+
+    int actual_iters = kmeans_iterations(kmeans_result);
+
+    if(actual_iters != max_iters && verbose) {
+    std::cout << std::endl << "@ WARNING: Number of actual iterations "
+        << actual_iters << " is less than max_iters of "
+        << max_iters << " " << std::endl;
+    std::cout << "@ Tolerance: " << tol << std::endl;
+    }
+
+    return kmeans_result;
+
+}
+
+
+dm::NumericTablePtr
+kmeans_predict_test(dm::NumericTablePtr X_nt, dm::NumericTablePtr X_init_nt) {
+
+    dm::NumericTablePtr seeding_centroids = X_init_nt;
+
+    int n_clusters = seeding_centroids->getNumberOfRows();
+    da::kmeans::Batch<double> algorithm(n_clusters, 0);
+    algorithm.input.set(da::kmeans::data, X_nt);
+    algorithm.input.set(da::kmeans::inputCentroids, seeding_centroids);
+    algorithm.parameter.assignFlag = 1;
+    algorithm.parameter.accuracyThreshold = 0.0;
+    algorithm.compute();
+
+    return algorithm.getResult()->get(da::kmeans::assignments);
+
+}
+
+
+struct kmeans_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL KMeans clustering";
+    }
+
+    static const char *header() {
+        return "Batch,Arch,Prefix,Threads,Size,Function,Time";
+    }
+
+    struct timing_options fit_opts = {100, 100, 10., 10};
+    struct timing_options predict_opts = {10, 100, 10., 10};
+    struct serving_options serve_opts;
+    std::string filex, filei;
+    double tol = 0.;
+    int data_multiplier = 100;
+    std::vector<std::string> bounds;
+    struct minibatch_options minibatch_opts;
+    bool gemm = false;
+
+    dm::NumericTablePtr X_nt, X_init_nt, X_mult_nt;
+    double *X_mult = NULL;
+
+    ~kmeans_bench() {
+        daal::services::daal_free(X_mult);
+    }
+
+    void add_args(CLI::App &app) {
+
+        add_timing_args(app, "fit", fit_opts);
+        add_timing_args(app, "predict", predict_opts);
+        add_serving_args(app, serve_opts);
+
+        app.add_option("-x,--filex,--fileX,--file-X-train", filex,
+                       "Feature file name")
+            ->required()->check(CLI::ExistingFile);
+        app.add_option("-i,--filei,--fileI", filei,
+                       "Initial cluster centers file name")
+            ->required()->check(CLI::ExistingFile);
+
+        app.add_option("-t,--tol", tol, "Absolute threshold");
+
+        app.add_option("-m,--data-multiplier", data_multiplier,
+                       "Data multiplier");
+
+        app.add_option("--bounds", bounds,
+                       "Also time native KMeans engines skipping distances "
+                       "with Hamerly's or Elkan's bounds, for the same "
+                       "iterations as DAAL")
+            ->check(CLI::IsMember({"hamerly", "elkan"}));
+
+        add_minibatch_args(app, minibatch_opts);
+
+        app.add_flag("--gemm", gemm,
+                     "Also time assignment of points to centroids with a "
+                     "native kernel built on blocked MKL GEMM");
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        struct npyarr *arrX = load_array(filex, 2, "X");
+        struct npyarr *arrX_init = load_array(filei, 2, "X_init");
+        if (!arrX || !arrX_init)
+            return false;
+
+        // Infer data size from loaded arrays
+        std::ostringstream stringSizeStream;
+        stringSizeStream << arrX->shape[0] << 'x' << arrX->shape[1];
+        ctx.size = stringSizeStream.str();
+
+        // Create numeric tables from input data
+        trace_span span("make_table");
+        X_nt = make_table((double *) arrX->data,
+                          arrX->shape[0], arrX->shape[1]);
+        X_init_nt = make_table((double *) arrX_init->data,
+                               arrX_init->shape[0], arrX_init->shape[1]);
+
+        // Apply data multiplier for KMeans prediction
+        X_mult = (double*) daal::services::daal_malloc(
+                X_nt->getNumberOfColumns() * X_nt->getNumberOfRows() *
+                data_multiplier * sizeof(double));
+
+        for (int i = 0; i < data_multiplier; i++) {
+            for (int j = 0;
+                 j < X_nt->getNumberOfColumns() * X_nt->getNumberOfRows();
+                 j++) {
+                X_mult[i * X_nt->getNumberOfColumns()
+                    * X_nt->getNumberOfRows() + j] = ((double *) arrX->data)[j];
+            }
+        }
+
+        X_mult_nt = make_table(
+                (double *) X_mult, arrX->shape[0], arrX->shape[1]);
+
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {}
+
+    /*
+     * Time a native engine for the iterations DAAL ran, comparing its
+     * centroids and the distances it computed with DAAL's.
+     */
+    void run_bounded(bench_runner &runner, const std::string &method,
+                     da::kmeans::ResultPtr kmeans_result, double daal_time) {
+
+        size_t n = X_nt->getNumberOfRows(), k = X_init_nt->getNumberOfRows();
+        if (method == "elkan" && !kmeans_elkan_fits(n, k)) {
+            std::cerr << "warning: skipping elkan, whose " << n << 'x' << k
+                      << " lower bounds don't fit in "
+                      << (KMEANS_ELKAN_MAX_BYTES >> 30) << " GiB"
+                      << std::endl;
+            return;
+        }
+
+        size_t iters = kmeans_iterations(kmeans_result);
+        double time;
+        kmeans_bounds_result result;
+        {
+            trace_span span("kmeans_bounded", method);
+            std::tie(time, result) = runner.time([&] {
+                    return kmeans_bounded(method, X_nt, X_init_nt, iters);
+                }, fit_opts);
+        }
+        runner.report("KMeans.fit_" + method, time);
+
+        double lloyd = (double) iters * n * k;
+        std::cout << "@ KMeans.fit_" << method << ": " << iters
+                  << " iterations, " << time / iters * 1e3
+                  << " ms per iteration (DAAL " << daal_time / iters * 1e3
+                  << " ms), " << 100. * (1. - result.distances / lloyd)
+                  << "% of " << lloyd << " distances skipped, "
+                  << result.center_distances
+                  << " distances between centroids" << std::endl;
+
+        double diff = max_centroid_difference(
+                result.centroids, kmeans_result->get(da::kmeans::centroids));
+        if (diff > 1e-6) {
+            std::cerr << "warning: " << method << " centroids differ from "
+                      << "DAAL by up to " << diff << std::endl;
+        }
+
+    }
+
+    /*
+     * Time mini-batch KMeans to the objective of DAAL's centroids on the
+     * held out rows. DAAL's centroids were fit on all rows, so it gets to
+     * see the holdout.
+     */
+    void run_minibatch(bench_runner &runner,
+                       da::kmeans::ResultPtr kmeans_result, double daal_time) {
+
+        size_t n = X_nt->getNumberOfRows(), d = X_nt->getNumberOfColumns();
+        size_t k = X_init_nt->getNumberOfRows();
+        size_t n_train = n - (size_t) (n * minibatch_opts.holdout);
+        if (n_train == 0 || n_train == n) {
+            std::cerr << "warning: skipping mini-batch KMeans, with no rows "
+                      << "to train or evaluate on" << std::endl;
+            return;
+        }
+
+        dm::BlockDescriptor<double> block_X, block_C, block_init;
+        X_nt->getBlockOfRows(0, n, dm::readOnly, block_X);
+        dm::NumericTablePtr centroids_nt
+            = kmeans_result->get(da::kmeans::centroids);
+        centroids_nt->getBlockOfRows(0, k, dm::readOnly, block_C);
+        X_init_nt->getBlockOfRows(0, k, dm::readOnly, block_init);
+        const double *X = block_X.getBlockPtr();
+
+        double daal_objective = kmeans_objective(
+                X + n_train * d, n - n_train, d, block_C.getBlockPtr(), k);
+        if (runner.verbose()) {
+            dm::BlockDescriptor<double> block_obj;
+            dm::NumericTablePtr obj_nt
+                = kmeans_result->get(da::kmeans::objectiveFunction);
+            obj_nt->getBlockOfRows(0, 1, dm::readOnly, block_obj);
+            std::cout << "@ KMeans objective of DAAL's centroids on all "
+                      << "rows: " << block_obj.getBlockPtr()[0]
+                      << " (DAAL), "
+                      << kmeans_objective(X, n, d, block_C.getBlockPtr(), k)
+                      << " (native)" << std::endl;
+            obj_nt->releaseBlockOfRows(block_obj);
+        }
+
+        double min_gap = *std::min_element(minibatch_opts.gaps.begin(),
+                                           minibatch_opts.gaps.end());
+        std::vector<double> init(block_init.getBlockPtr(),
+                                 block_init.getBlockPtr() + k * d);
+        minibatch_result result = kmeans_minibatch(
+                X, n, d, n_train, init, minibatch_opts,
+                daal_objective * (1. + min_gap));
+
+        X_init_nt->releaseBlockOfRows(block_init);
+        centroids_nt->releaseBlockOfRows(block_C);
+        X_nt->releaseBlockOfRows(block_X);
+
+        if (runner.verbose()) {
+            for (auto &point : result.trace) {
+                std::cout << "@ KMeans.minibatch: " << point.batches
+                          << " batches, " << point.time * 1e3 << " ms, "
+                          << "objective " << point.objective / daal_objective
+                          << "x DAAL's" << std::endl;
+            }
+        }
+
+        for (double gap : minibatch_opts.gaps) {
+            std::ostringstream function;
+            function << "KMeans.minibatch_within_" << gap * 100. << "pct";
+            double time = minibatch_time_to(result,
+                                            daal_objective * (1. + gap));
+            if (time < 0.) {
+                std::cerr << "warning: mini-batch KMeans didn't get within "
+                          << gap * 100. << "% of DAAL's objective in "
+                          << result.trace.back().batches << " batches"
+                          << std::endl;
+                continue;
+            }
+            runner.report_measured(function.str(), time);
+            std::cout << "@ " << function.str() << ": " << time / daal_time
+                      << "x the time of KMeans.fit" << std::endl;
+        }
+
+    }
+
+    void run(bench_runner &runner) {
+
+        double time;
+        da::kmeans::ResultPtr kmeans_result;
+        std::tie(time, kmeans_result) = runner.time([&] {
+                    return kmeans_fit_test(X_nt, X_init_nt, tol,
+                                           runner.verbose());
+                }, fit_opts);
+
+        // Each iteration computes distances of all points to all centroids
+        double n = X_nt->getNumberOfRows(), d = X_nt->getNumberOfColumns();
+        double k = X_init_nt->getNumberOfRows();
+        double iters = kmeans_iterations(kmeans_result);
+        runner.work(iters * (3. * n * k * d + n * d),
+                    iters * n * d * sizeof(double));
+        runner.report("KMeans.fit", time);
+
+        for (auto &method : bounds)
+            run_bounded(runner, method, kmeans_result, time);
+        if (minibatch_opts.enabled)
+            run_minibatch(runner, kmeans_result, time);
+
+        dm::NumericTablePtr predict_result;
+        std::tie(time, predict_result) = runner.time([&] {
+                    return kmeans_predict_test(X_mult_nt, X_init_nt);
+                }, predict_opts);
+        n = X_mult_nt->getNumberOfRows();
+        runner.work(3. * n * k * d, n * d * sizeof(double));
+        runner.report("KMeans.predict", time);
+
+        if (gemm) {
+            double daal_time = time;
+            dm::NumericTablePtr gemm_result;
+            {
+                trace_span span("gemm_assign");
+                std::tie(time, gemm_result) = runner.time([&] {
+                            return gemm_assign(X_mult_nt, X_init_nt);
+                        }, predict_opts);
+            }
+            runner.work(2. * n * k * d, n * d * sizeof(double));
+            runner.report("KMeans.predict_gemm", time);
+
+            // Near ties between centroids can be broken differently
+            print_gemm_comparison("KMeans.predict_gemm", 2. * n * k * d,
+                                  time, daal_time);
+            size_t n_differ = n - count_same_labels(predict_result,
+                                                    gemm_result);
+            std::cout << "@ KMeans.predict_gemm: " << n_differ << " of " << n
+                      << " assignments differ from DAAL" << std::endl;
+        }
+
+        runner.serve("KMeans.serve", [&](dm::NumericTablePtr X) {
+                return kmeans_predict_test(X, X_init_nt);
+            }, X_nt, serve_opts);
+
+    }
+
+};
@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native KMeans engines which skip point-centroid distance computations
+ * with triangle inequality bounds, benchmarked against DAAL's Lloyd
+ * iterations with --bounds.
+ *
+ * Hamerly's algorithm keeps an upper bound on the distance of each point
+ * to its centroid and one lower bound on its distance to every other
+ * centroid. A point whose upper bound is below its lower bound, or below
+ * half the distance from its centroid to the nearest other centroid,
+ * can't change cluster, so its distances aren't computed. Points which
+ * may change cluster are collected per block and scanned against tiles of
+ * centroids, so a tile stays in cache for all of them.
+ *
+ * Elkan's algorithm keeps a lower bound for each point and centroid
+ * (n x k of them), and also skips centroids which are too far from the
+ * point's centroid, computing fewer distances at the cost of memory.
+ *
+ * Both run the same Lloyd iterations: assign points to their nearest
+ * centroid, then move each centroid to the mean of its points. A cluster
+ * left empty keeps its centroid.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "daal.h"
+#include "common.hpp"
+
+namespace dm = daal::data_management;
+
+// Points bounded and assigned by one task
+#define KMEANS_BLOCK 1024
+// Centroids scanned together for the points of a block
+#define KMEANS_TILE 64
+// Largest Elkan lower bound matrix, in bytes
+#define KMEANS_ELKAN_MAX_BYTES (size_t(8) << 30)
+
+
+struct kmeans_bounds_result {
+    std::vector<double> centroids;  // k x d
+    std::vector<int> assignments;   // Cluster of each point at the last
+                                    // assignment
+    size_t iterations;
+    size_t distances;               // Point-centroid distances computed
+    size_t center_distances;        // Centroid-centroid distances computed
+};
+
+
+double squared_distance(const double *a, const double *b, size_t d) {
+
+    double s = 0.;
+    for (size_t j = 0; j < d; j++) {
+        double t = a[j] - b[j];
+        s += t * t;
+    }
+    return s;
+
+}
+
+
+/*
+ * State shared by the Hamerly and Elkan engines.
+ */
+struct kmeans_state {
+    size_t n, d, k;
+    const double *X;
+    std::vector<double> centroids;
+    std::vector<int> assignments;
+    std::vector<double> upper;     // Distance of each point to its centroid
+    std::vector<double> lower;     // Lower bounds to other centroids
+    std::vector<double> half_nearest; // Half the distance from each
+                                      // centroid to the nearest other one
+    std::vector<double> moved;     // Movement of each centroid
+    tbb::enumerable_thread_specific<std::vector<double>> sums;
+    std::atomic<size_t> distances;
+    size_t center_distances;
+
+    kmeans_state(const double *X, size_t n, size_t d,
+                 dm::NumericTablePtr init_nt)
+        : n(n), d(d), k(init_nt->getNumberOfRows()), X(X),
+          assignments(n), upper(n), half_nearest(k), moved(k),
+          sums([=] { return std::vector<double>(k * (d + 1)); }),
+          distances(0), center_distances(0) {
+
+        dm::BlockDescriptor<double> block;
+        init_nt->getBlockOfRows(0, k, dm::readOnly, block);
+        centroids.assign(block.getBlockPtr(), block.getBlockPtr() + k * d);
+        init_nt->releaseBlockOfRows(block);
+
+    }
+
+    /* Add point i to the sums of its cluster */
+    void accumulate(std::vector<double> &s, size_t i) {
+        double *c = s.data() + assignments[i] * (d + 1);
+        const double *x = X + i * d;
+        for (size_t j = 0; j < d; j++)
+            c[j] += x[j];
+        c[d] += 1.;
+    }
+};
+
+
+/*
+ * Distances between all pairs of centroids (if wanted) and half the
+ * distance from each centroid to its nearest other one.
+ */
+void kmeans_center_distances(kmeans_state &state,
+                             std::vector<double> *center_dist) {
+
+    size_t k = state.k, d = state.d;
+    const double *C = state.centroids.data();
+    tbb::parallel_for(size_t(0), k, [&](size_t a) {
+        double nearest = std::numeric_limits<double>::infinity();
+        for (size_t b = 0; b < k; b++) {
+            if (b == a)
+                continue;
+            double dist = std::sqrt(squared_distance(C + a * d, C + b * d,
+                                                     d));
+            nearest = std::min(nearest, dist);
+            if (center_dist)
+                (*center_dist)[a * k + b] = dist;
+        }
+        state.half_nearest[a] = nearest / 2.;
+    });
+    state.center_distances += k * (k - 1);
+
+}
+
+
+/*
+ * Move each centroid to the mean of its points, recording how far it
+ * moved. Returns the index of the centroid which moved most.
+ */
+size_t kmeans_update_centroids(kmeans_state &state) {
+
+    size_t k = state.k, d = state.d;
+    tbb::parallel_for(size_t(0), k, [&](size_t c) {
+        std::vector<double> mean(d + 1, 0.);
+        for (auto &s : state.sums) {
+            for (size_t j = 0; j <= d; j++)
+                mean[j] += s[c * (d + 1) + j];
+        }
+        double *centroid = state.centroids.data() + c * d;
+        if (mean[d] == 0.) {
+            state.moved[c] = 0.;
+            return;
+        }
+        for (size_t j = 0; j < d; j++)
+            mean[j] /= mean[d];
+        state.moved[c] = std::sqrt(squared_distance(centroid, mean.data(),
+                                                    d));
+        std::copy(mean.begin(), mean.begin() + d, centroid);
+    });
+
+    for (auto &s : state.sums)
+        std::fill(s.begin(), s.end(), 0.);
+    return std::max_element(state.moved.begin(), state.moved.end())
+        - state.moved.begin();
+
+}
+
+
+/*
+ * Find the nearest and second nearest centroids of the given points,
+ * scanning tiles of centroids against all points, and set their
+ * assignment, upper bound and (Hamerly) lower bound.
+ */
+void kmeans_scan(kmeans_state &state, const std::vector<size_t> &points) {
+
+    size_t m = points.size(), d = state.d, k = state.k;
+    if (m == 0)
+        return;
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> best(m, inf), second(m, inf);
+    std::vector<int> best_c(m, 0);
+
+    for (size_t t = 0; t < k; t += KMEANS_TILE) {
+        size_t t_end = std::min(t + KMEANS_TILE, k);
+        for (size_t p = 0; p < m; p++) {
+            const double *x = state.X + points[p] * d;
+            for (size_t c = t; c < t_end; c++) {
+                double dist = squared_distance(
+                        x, state.centroids.data() + c * d, d);
+                if (dist < best[p]) {
+                    second[p] = best[p];
+                    best[p] = dist;
+                    best_c[p] = c;
+                } else if (dist < second[p]) {
+                    second[p] = dist;
+                }
+            }
+        }
+    }
+
+    for (size_t p = 0; p < m; p++) {
+        size_t i = points[p];
+        state.assignments[i] = best_c[p];
+        state.upper[i] = std::sqrt(best[p]);
+        state.lower[i] = std::sqrt(second[p]);
+    }
+    state.distances += m * k;
+
+}
+
+
+/*
+ * Run the given number of iterations of Hamerly's algorithm on the n x d
+ * rows of X from the centroids in init_nt.
+ */
+kmeans_bounds_result kmeans_hamerly(dm::NumericTablePtr X_nt,
+                                    dm::NumericTablePtr init_nt,
+                                    size_t iterations) {
+
+    size_t n = X_nt->getNumberOfRows(), d = X_nt->getNumberOfColumns();
+    dm::BlockDescriptor<double> block;
+    X_nt->getBlockOfRows(0, n, dm::readOnly, block);
+
+    kmeans_state state(block.getBlockPtr(), n, d, init_nt);
+    state.lower.resize(n);
+
+    for (size_t it = 0; it < iterations; it++) {
+        if (it > 0)
+            kmeans_center_distances(state, nullptr);
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, n, KMEANS_BLOCK),
+            [&](const tbb::blocked_range<size_t> &r) {
+                std::vector<size_t> need;
+                size_t computed = 0;
+                for (size_t i = r.begin(); i < r.end(); i++) {
+                    if (it == 0) {
+                        need.push_back(i);
+                        continue;
+                    }
+                    int a = state.assignments[i];
+                    double bound = std::max(state.half_nearest[a],
+                                            state.lower[i]);
+                    if (state.upper[i] <= bound)
+                        continue;
+                    // Tighten the upper bound before scanning
+                    state.upper[i] = std::sqrt(squared_distance(
+                                state.X + i * d,
+                                state.centroids.data() + a * d, d));
+                    computed++;
+                    if (state.upper[i] > bound)
+                        need.push_back(i);
+                }
+                state.distances += computed;
+                kmeans_scan(state, need);
+
+                auto &sums = state.sums.local();
+                for (size_t i = r.begin(); i < r.end(); i++)
+                    state.accumulate(sums, i);
+            });
+
+        size_t most = kmeans_update_centroids(state);
+        double max_moved = state.moved[most];
+        double second_moved = 0.;
+        for (size_t c = 0; c < state.k; c++) {
+            if (c != most)
+                second_moved = std::max(second_moved, state.moved[c]);
+        }
+        tbb::parallel_for(size_t(0), n, [&](size_t i) {
+            size_t a = state.assignments[i];
+            state.upper[i] += state.moved[a];
+            state.lower[i] -= (a == most) ? second_moved : max_moved;
+        });
+    }
+
+    X_nt->releaseBlockOfRows(block);
+
+    kmeans_bounds_result result;
+    result.centroids = state.centroids;
+    result.assignments = state.assignments;
+    result.iterations = iterations;
+    result.distances = state.distances;
+    result.center_distances = state.center_distances;
+    return result;
+
+}
+
+
+/*
+ * Run the given number of iterations of Elkan's algorithm on the n x d
+ * rows of X from the centroids in init_nt.
+ */
+kmeans_bounds_result kmeans_elkan(dm::NumericTablePtr X_nt,
+                                  dm::NumericTablePtr init_nt,
+                                  size_t iterations) {
+
+    size_t n = X_nt->getNumberOfRows(), d = X_nt->getNumberOfColumns();
+    dm::BlockDescriptor<double> block;
+    X_nt->getBlockOfRows(0, n, dm::readOnly, block);
+
+    kmeans_state state(block.getBlockPtr(), n, d, init_nt);
+    size_t k = state.k;
+    state.lower.resize(n * k);
+    std::vector<double> center_dist(k * k, 0.);
+
+    for (size_t it = 0; it < iterations; it++) {
+        if (it > 0)
+            kmeans_center_distances(state, &center_dist);
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, n, KMEANS_BLOCK),
+            [&](const tbb::blocked_range<size_t> &r) {
+                size_t computed = 0;
+                for (size_t i = r.begin(); i < r.end(); i++) {
+                    const double *x = state.X + i * d;
+                    double *lower = state.lower.data() + i * k;
+
+                    if (it == 0) {
+                        int a = 0;
+                        for (size_t c = 0; c < k; c++) {
+                            lower[c] = std::sqrt(squared_distance(
+                                        x, state.centroids.data() + c * d,
+                                        d));
+                            if (lower[c] < lower[a])
+                                a = c;
+                        }
+                        state.assignments[i] = a;
+                        state.upper[i] = lower[a];
+                        computed += k;
+                        continue;
+                    }
+
+                    int a = state.assignments[i];
+                    double u = state.upper[i];
+                    if (u <= state.half_nearest[a])
+                        continue;
+
+                    bool stale = true;
+                    for (size_t c = 0; c < k; c++) {
+                        if ((int) c == a || u <= lower[c]
+                            || u <= center_dist[a * k + c] / 2.)
+                            continue;
+                        if (stale) {
+                            u = std::sqrt(squared_distance(
+                                        x, state.centroids.data() + a * d,
+                                        d));
+                            lower[a] = u;
+                            computed++;
+                            stale = false;
+                            if (u <= lower[c]
+                                || u <= center_dist[a * k + c] / 2.)
+                                continue;
+                        }
+                        lower[c] = std::sqrt(squared_distance(
+                                    x, state.centroids.data() + c * d, d));
+                        computed++;
+                        if (lower[c] < u) {
+                            a = c;
+                            u = lower[c];
+                        }
+                    }
+                    state.assignments[i] = a;
+                    state.upper[i] = u;
+                }
+                state.distances += computed;
+
+                auto &sums = state.sums.local();
+                for (size_t i = r.begin(); i < r.end(); i++)
+                    state.accumulate(sums, i);
+            });
+
+        kmeans_update_centroids(state);
+        tbb::parallel_for(size_t(0), n, [&](size_t i) {
+            double *lower = state.lower.data() + i * k;
+            for (size_t c = 0; c < k; c++)
+                lower[c] = std::max(lower[c] - state.moved[c], 0.);
+            state.upper[i] += state.moved[state.assignments[i]];
+        });
+    }
+
+    X_nt->releaseBlockOfRows(block);
+
+    kmeans_bounds_result result;
+    result.centroids = state.centroids;
+    result.assignments = state.assignments;
+    result.iterations = iterations;
+    result.distances = state.distances;
+    result.center_distances = state.center_distances;
+    return result;
+
+}
+
+
+/*
+ * Whether Elkan's n x k lower bounds fit in KMEANS_ELKAN_MAX_BYTES.
+ */
+bool kmeans_elkan_fits(size_t n, size_t k) {
+    return n * k * sizeof(double) <= KMEANS_ELKAN_MAX_BYTES;
+}
+
+
+kmeans_bounds_result kmeans_bounded(const std::string &method,
+                                    dm::NumericTablePtr X_nt,
+                                    dm::NumericTablePtr init_nt,
+                                    size_t iterations) {
+
+    if (method == "elkan")
+        return kmeans_elkan(X_nt, init_nt, iterations);
+    return kmeans_hamerly(X_nt, init_nt, iterations);
+
+}
+
+
+/*
+ * Largest absolute difference between centroids and those in a table.
+ */
+double max_centroid_difference(const std::vector<double> &centroids,
+                               dm::NumericTablePtr centroids_nt) {
+
+    size_t k = centroids_nt->getNumberOfRows();
+    size_t d = centroids_nt->getNumberOfColumns();
+    dm::BlockDescriptor<double> block;
+    centroids_nt->getBlockOfRows(0, k, dm::readOnly, block);
+    const double *c = block.getBlockPtr();
+
+    double diff = 0.;
+    for (size_t i = 0; i < std::min(k * d, centroids.size()); i++)
+        diff = std::max(diff, std::abs(centroids[i] - c[i]));
+
+    centroids_nt->releaseBlockOfRows(block);
+    return diff;
+
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native mini-batch KMeans (Sculley, 2010), for centroids refreshed from
+ * streams of data, benchmarked against DAAL's batch KMeans with
+ * --minibatch.
+ *
+ * Each step draws a batch of rows at random, assigns them to their
+ * nearest centroids, and moves each centroid towards its rows with a
+ * learning rate of one over the number of rows it has been given so far.
+ * Every few steps the objective (the sum of squared distances of rows to
+ * their nearest centroid, as DAAL's objectiveFunction) is evaluated on
+ * rows held out of training. The time to reach the objective of DAAL's
+ * centroids on the holdout, within some gaps, is reported against DAAL's
+ * fit time. Evaluation isn't counted in the time.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+#include "tbb/blocked_range.h"
+
+#include "CLI11.hpp"
+#include "common.hpp"
+
+
+struct minibatch_options {
+    bool enabled;
+    size_t batch_size;       // Rows per step
+    size_t max_batches;      // Steps before giving up on the targets
+    double holdout;          // Fraction of rows held out for evaluation
+    size_t eval_every;       // Steps between evaluations
+    unsigned seed;
+    std::vector<double> gaps; // Relative gaps to DAAL's objective to time
+};
+
+
+void add_minibatch_args(CLI::App &app, struct minibatch_options &opts) {
+
+    opts.enabled = false;
+    app.add_flag("--minibatch", opts.enabled,
+                 "Also run native mini-batch KMeans, timing how long it "
+                 "takes to get near the objective of DAAL's centroids on "
+                 "held out rows");
+
+    opts.batch_size = 1024;
+    app.add_option("--minibatch-size", opts.batch_size,
+                   "Rows per mini-batch", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.max_batches = 10000;
+    app.add_option("--minibatch-max-batches", opts.max_batches,
+                   "Mini-batches before giving up on reaching the "
+                   "objective", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.holdout = 0.1;
+    app.add_option("--minibatch-holdout", opts.holdout,
+                   "Fraction of rows (the last ones) held out of "
+                   "mini-batches to evaluate the objective on", true)
+        ->check(CLI::Range(0.01, 0.5));
+
+    opts.eval_every = 10;
+    app.add_option("--minibatch-eval-every", opts.eval_every,
+                   "Mini-batches between evaluations of the objective",
+                   true)
+        ->check(CLI::PositiveNumber);
+
+    opts.seed = 777;
+    app.add_option("--minibatch-seed", opts.seed,
+                   "Seed for drawing mini-batches", true);
+
+    opts.gaps = {0.05, 0.01};
+    app.add_option("--minibatch-gaps", opts.gaps,
+                   "Time reaching DAAL's objective within each of these "
+                   "relative gaps", true);
+
+}
+
+
+/*
+ * Sum of squared distances of the n x d rows of X to their nearest of
+ * the k x d centroids C.
+ */
+double kmeans_objective(const double *X, size_t n, size_t d,
+                        const double *C, size_t k) {
+
+    return tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(0, n, 256), 0.,
+        [&](const tbb::blocked_range<size_t> &r, double sum) {
+            for (size_t i = r.begin(); i < r.end(); i++) {
+                const double *x = X + i * d;
+                double best = std::numeric_limits<double>::infinity();
+                for (size_t c = 0; c < k; c++) {
+                    double dist = 0.;
+                    for (size_t j = 0; j < d; j++) {
+                        double t = x[j] - C[c * d + j];
+                        dist += t * t;
+                    }
+                    best = std::min(best, dist);
+                }
+                sum += best;
+            }
+            return sum;
+        },
+        [](double a, double b) { return a + b; });
+
+}
+
+
+struct minibatch_point {
+    double time;         // Seconds of training so far
+    size_t batches;
+    double objective;    // On the holdout
+};
+
+
+struct minibatch_result {
+    std::vector<double> centroids;
+    std::vector<minibatch_point> trace;
+};
+
+
+/*
+ * Run mini-batch KMeans on the first n_train of the n x d rows of X,
+ * from the k x d centroids init, evaluating on the rest. Stops after
+ * opts.max_batches steps or once the holdout objective is at most
+ * stop_objective.
+ */
+minibatch_result kmeans_minibatch(const double *X, size_t n, size_t d,
+                                  size_t n_train,
+                                  const std::vector<double> &init,
+                                  const struct minibatch_options &opts,
+                                  double stop_objective) {
+
+    trace_span span("kmeans_minibatch");
+    typedef std::chrono::steady_clock clock;
+    size_t k = init.size() / d;
+    const double *holdout = X + n_train * d;
+    size_t n_holdout = n - n_train;
+    size_t b = std::min(opts.batch_size, n_train);
+
+    minibatch_result result;
+    result.centroids = init;
+    double *C = result.centroids.data();
+    std::vector<size_t> counts(k, 0);
+    std::vector<size_t> batch(b), cluster(b), order(b);
+    std::vector<size_t> first(k + 1);
+
+    std::mt19937_64 rng(opts.seed);
+    std::uniform_int_distribution<size_t> row(0, n_train - 1);
+    double elapsed = 0.;
+
+    for (size_t step = 1; step <= opts.max_batches; step++) {
+        clock::time_point start = clock::now();
+
+        for (auto &i : batch)
+            i = row(rng);
+
+        // Assign the rows of the batch with the current centroids
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, b, 64),
+            [&](const tbb::blocked_range<size_t> &r) {
+                for (size_t p = r.begin(); p < r.end(); p++) {
+                    const double *x = X + batch[p] * d;
+                    double best = std::numeric_limits<double>::infinity();
+                    for (size_t c = 0; c < k; c++) {
+                        double dist = 0.;
+                        for (size_t j = 0; j < d; j++) {
+                            double t = x[j] - C[c * d + j];
+                            dist += t * t;
+                        }
+                        if (dist < best) {
+                            best = dist;
+                            cluster[p] = c;
+                        }
+                    }
+                }
+            });
+
+        // Group the rows by cluster, then move each centroid towards its
+        // rows in turn
+        std::fill(first.begin(), first.end(), 0);
+        for (size_t p = 0; p < b; p++)
+            first[cluster[p] + 1]++;
+        for (size_t c = 0; c < k; c++)
+            first[c + 1] += first[c];
+        std::vector<size_t> next(first.begin(), first.end() - 1);
+        for (size_t p = 0; p < b; p++)
+            order[next[cluster[p]]++] = p;
+
+        tbb::parallel_for(size_t(0), k, [&](size_t c) {
+            double *centroid = C + c * d;
+            for (size_t q = first[c]; q < first[c + 1]; q++) {
+                const double *x = X + batch[order[q]] * d;
+                double eta = 1. / ++counts[c];
+                for (size_t j = 0; j < d; j++)
+                    centroid[j] += eta * (x[j] - centroid[j]);
+            }
+        });
+
+        elapsed += std::chrono::duration<double>(clock::now()
+                                                 - start).count();
+
+        if (step % opts.eval_every == 0 || step == opts.max_batches) {
+            double objective = kmeans_objective(holdout, n_holdout, d, C, k);
+            result.trace.push_back({elapsed, step, objective});
+            if (objective <= stop_objective)
+                break;
+        }
+    }
+
+    return result;
+
+}
+
+
+/*
+ * Training time of the first evaluation with a holdout objective of at
+ * most target, or a negative time if none reached it.
+ */
+double minibatch_time_to(const minibatch_result &result, double target) {
+
+    for (auto &point : result.trace) {
+        if (point.objective <= target)
+            return point.time;
+    }
+    return -1.;
+
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2017-2019 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <chrono>  
+
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "daal.h"
+
+namespace dal=da::linear_regression;
+
+
+dal::training::ResultPtr
+linear_fit_test(double *X, double *y, size_t rows, size_t cols,
+                size_t y_cols) {
+
+    dal::training::Batch<double> training_algorithm;
+    training_algorithm.input.set(dal::training::data, make_table(X, rows, cols));
+    training_algorithm.input.set(dal::training::dependentVariables, make_table(y, rows, y_cols));
+    training_algorithm.compute();
+    return training_algorithm.getResult();
+
+}
+
+
+dm::NumericTablePtr
+linear_predict_test(dal::training::ResultPtr training_result,
+                    dm::NumericTablePtr X_nt) {
+
+    dal::prediction::Batch<double> predict_algorithm;
+    predict_algorithm.input.set(dal::prediction::data, X_nt);
+    predict_algorithm.input.set(dal::prediction::model, training_result->get(dal::training::model));
+    predict_algorithm.compute();
+    return predict_algorithm.getResult()->get(dal::prediction::prediction);
+
+}
+
+
+dm::NumericTablePtr
+linear_predict_test(dal::training::ResultPtr training_result,
+                    double *X, size_t rows, size_t cols) {
+
+    return linear_predict_test(training_result, make_table(X, rows, cols));
+
+}
+
+
+struct linear_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL linear regression";
+    }
+
+    static const char *header() {
+        return "Batch,Arch,Prefix,Threads,Size,Function,Time";
+    }
+
+    struct timing_options fit_opts = {100, 100, 10., 10};
+    struct timing_options predict_opts = {10, 100, 10., 10};
+    struct serving_options serve_opts;
+    std::string stringSize = "1000000x50";
+    std::string xfn, yfn;
+
+    std::vector<int> size, y_size;
+    double *X, *Xp, *y;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-s,--size", stringSize, "Problem size");
+
+        app.add_option("-x,--fileX,--file-X-train", xfn,
+                       "Feature file name (random data is used if not given)")
+            ->check(CLI::ExistingFile);
+        app.add_option("-y,--fileY,--file-y-train", yfn,
+                       "Target file name (random data is used if not given)")
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "fit", fit_opts);
+        add_timing_args(app, "predict", predict_opts);
+        add_serving_args(app, serve_opts);
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        X = load_or_gen_random(xfn, size, stringSize);
+        if (!X)
+            return false;
+        Xp = xfn.empty() ? gen_random(size[0] * size[1]) : X;
+        std::string yStringSize = stringSize;
+        y = load_or_gen_random(yfn, y_size, yStringSize);
+        if (!y)
+            return false;
+        if (y_size[0] != size[0]) {
+            std::cerr << "error: X has " << size[0] << " rows but y has "
+                      << y_size[0] << std::endl;
+            return false;
+        }
+
+        ctx.size = stringSize;
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {}
+
+    void run(bench_runner &runner) {
+
+        double time;
+        dal::training::ResultPtr training_result;
+        std::tie(time, training_result) = runner.time([&] {
+                return linear_fit_test(X, y, size[0], size[1], y_size[1]);
+            }, fit_opts);
+
+        // Fitting forms X^T X and X^T y, with a column for the intercept
+        double n = size[0], d = size[1], k = y_size[1];
+        runner.work(n * (d + 1) * (d + 1) + 2. * n * (d + 1) * k,
+                    n * (d + k) * sizeof(double));
+        runner.report("Linear.fit", time);
+
+        dm::NumericTablePtr predict_result;
+        std::tie(time, predict_result) = runner.time([&] {
+                return linear_predict_test(training_result, Xp, size[0], size[1]);
+            }, predict_opts);
+        runner.work(2. * n * d * k, n * (d + k) * sizeof(double));
+        runner.report("Linear.predict", time);
+
+        runner.serve("Linear.serve", [&](dm::NumericTablePtr X) {
+                return linear_predict_test(training_result, X);
+            }, make_table(Xp, size[0], size[1]), serve_opts);
+
+    }
+
+};
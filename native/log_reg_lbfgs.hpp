@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2018-2019 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <chrono>  
+#include <cassert>
+
+#define DAAL_DATA_TYPE double
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "cv.hpp"
+#include "daal.h"
+#include "mkl.h"
+#include "npyfile.h"
+#include "lbfgsb/lbfgsb_daal.h"
+
+namespace dm=daal::data_management;
+namespace ds=daal::services;
+namespace da=daal::algorithms;
+namespace dl=daal::algorithms::logistic_regression;
+
+using namespace daal;
+using namespace da;
+
+void print_numeric_table(dm::NumericTablePtr, std::string);
+
+dl::training::ResultPtr 
+logistic_regression_fit(
+    int nClasses,
+    bool fit_intercept,
+    double C,
+    size_t max_iter,
+    double tol, 
+    dm::NumericTablePtr Xt,
+    dm::NumericTablePtr Yt,
+    bool verbose)
+{
+    size_t n_samples = Yt->getNumberOfRows();
+
+    ds::SharedPtr<lbfgsb::Batch> lbfgsSolver(new lbfgsb::Batch());
+
+    lbfgsSolver->parameter.nIterations = max_iter;
+    lbfgsSolver->parameter.accuracyThreshold = tol;
+    lbfgsSolver->parameter.iprint = (verbose) ? 1 : -1;
+    lbfgsSolver->parameter.funcScaling = n_samples;
+    lbfgsSolver->parameter.gradScaling = n_samples;
+
+
+    dl::training::Batch<double> log_reg_alg(nClasses);
+    log_reg_alg.parameter().interceptFlag = fit_intercept;
+    log_reg_alg.parameter().penaltyL1 = 0.;
+    log_reg_alg.parameter().penaltyL2 = 0.5 / C / n_samples;
+
+    log_reg_alg.parameter().optimizationSolver = lbfgsSolver;
+
+    if (verbose) {
+	std::cout << "@ {'fit_intercept': " << fit_intercept << 
+                    ", 'C': " << C << 
+                    ", 'max_iter': " <<  max_iter << 
+                    ", 'tol': " << tol << 
+                    "}" <<  std::endl;
+    }
+
+    log_reg_alg.input.set(da::classifier::training::data, Xt);
+    log_reg_alg.input.set(da::classifier::training::labels, Yt);
+
+    log_reg_alg.compute();
+
+    dl::training::ResultPtr result_ptr = log_reg_alg.getResult();
+
+    if(verbose) {
+	print_numeric_table(
+	    lbfgsSolver->getResult()->get(da::optimization_solver::iterative_solver::nIterations),
+	    "Number of iterations");
+	print_numeric_table(
+	    result_ptr->get(da::classifier::training::model)->getBeta(),
+	    "Fitted coefficients"
+	    );
+    }
+
+    return result_ptr;
+}
+
+dm::NumericTablePtr 
+logistic_regression_predict(
+    int nClasses,
+    dl::training::ResultPtr training_result_ptr,
+    dm::NumericTablePtr Xt, 
+    bool verbose
+    )
+{
+    dl::prediction::Batch<double> pred_alg(nClasses);
+    pred_alg.input.set(da::classifier::prediction::data, Xt);
+    pred_alg.input.set(da::classifier::prediction::model, 
+		       training_result_ptr->get(da::classifier::training::model));
+
+    pred_alg.compute();
+
+    da::classifier::prediction::ResultPtr pred_res = pred_alg.getResult();
+    dm::NumericTablePtr Y_pred_t = pred_res->get(da::classifier::prediction::prediction);
+
+    return Y_pred_t;
+}
+
+struct log_reg_lbfgs_bench {
+
+    static const char *description() {
+        return "Native benchmark code for Intel(R) DAAL logistic regression classifier";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,classes,"
+               "solver,tol,maxiter,C,function,accuracy,time";
+    }
+
+    std::string xfn = "./data/mX.csv";
+    std::string yfn = "./data/mY.csv";
+    struct timing_options fit_opts = {100, 100, 10., 10};
+    struct timing_options predict_opts = {10, 100, 10., 10};
+    struct serving_options serve_opts;
+    struct cv_options cv_opts;
+    double C = 1.0;
+    double tol = 1e-10;
+    size_t max_iter = 1000;
+    bool fit_intercept = true;
+
+    dm::NumericTablePtr X_nt, Y_nt;
+    int n_classes;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-x,--fileX,--file-X-train", xfn, "Feature file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        app.add_option("-y,--fileY,--file-y-train", yfn, "Labels file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "fit", fit_opts);
+        add_timing_args(app, "predict", predict_opts);
+        add_serving_args(app, serve_opts);
+        add_cv_args(app, cv_opts);
+
+        app.add_option("-C,--C", C, "Slack parameter")
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--tol", tol, "Tolerance")
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--maxiter", max_iter,
+                       "Maximum iterations for the iterative solver")
+            ->check(CLI::PositiveNumber);
+
+        // TODO add configurable fit_intercept parameter
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        struct npyarr *arrX = load_array(xfn, 2, "X");
+        struct npyarr *arrY = load_array(yfn, 1, "y", "i8");
+        if (!arrX || !arrY)
+            return false;
+
+        /* Create numeric tables */
+        X_nt = dm::HomogenNumericTable<double>::create(
+                (double *) arrX->data, arrX->shape[1], arrX->shape[0]);
+        Y_nt = dm::HomogenNumericTable<int64_t>::create(
+                (int64_t *) arrY->data, 1, arrY->shape[0]);
+
+        size_t n_rows = Y_nt->getNumberOfRows();
+        size_t n_features = X_nt->getNumberOfColumns();
+        std::ostringstream string_size_stream;
+        string_size_stream << n_rows << 'x' << n_features;
+        ctx.size = string_size_stream.str();
+
+        // DAAL threads are already set, MKL must use TBB as well
+        mkl_set_threading_layer(MKL_THREADING_TBB);
+
+        n_classes = count_classes(Y_nt);
+        return check_cv_options(cv_opts, n_rows);
+
+    }
+
+    void write_meta(std::ostream &os) {
+        os << n_classes << ','
+           << "lbfgs" << ','
+           << tol << ','
+           << max_iter << ','
+           << C << ',';
+    }
+
+    void run(bench_runner &runner) {
+
+        double time;
+        bool verbose_fit = runner.verbose();
+        dl::training::ResultPtr training_result;
+        {
+            trace_span span("logistic_regression_fit");
+            std::tie(time, training_result) = runner.time([&] {
+                    auto r = logistic_regression_fit(n_classes, fit_intercept,
+                                                     C, max_iter, tol, X_nt,
+                                                     Y_nt, verbose_fit);
+                    verbose_fit = false;
+                    return r;
+                }, fit_opts);
+        }
+        runner.report("LogReg.fit", time, "");
+
+        dm::NumericTablePtr Yp_nt;
+        std::tie(time, Yp_nt) = runner.time([&] {
+                return logistic_regression_predict(n_classes, training_result,
+                                                   X_nt, runner.verbose());
+            }, predict_opts);
+
+        double accuracy = accuracy_score(Y_nt, Yp_nt) * 100.;
+        double n = X_nt->getNumberOfRows(), d = X_nt->getNumberOfColumns();
+        double n_coefs = n_classes == 2 ? 1 : n_classes;
+        runner.work(2. * n * d * n_coefs, n * d * sizeof(double));
+        runner.report("LogReg.predict", time, accuracy);
+
+        runner.serve("LogReg.serve", [&](dm::NumericTablePtr X) {
+                return logistic_regression_predict(n_classes, training_result,
+                                                   X, false);
+            }, X_nt, serve_opts);
+
+        run_cv(runner, "LogReg", X_nt, Y_nt, cv_opts,
+            [&](dm::NumericTablePtr X, dm::NumericTablePtr Y,
+                dm::NumericTablePtr X_test, dm::NumericTablePtr Y_test) {
+                auto r = logistic_regression_fit(n_classes, fit_intercept, C,
+                                                 max_iter, tol, X, Y, false);
+                auto Yp = logistic_regression_predict(n_classes, r, X_test,
+                                                      false);
+                return accuracy_score(Y_test, Yp) * 100.;
+            },
+            [&](const std::string &function, double time, double score) {
+                runner.report(function, time, score);
+            });
+
+    }
+
+};
@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Serving of several models at once on one host, each in its own
+ * tbb::task_arena with a share of the threads, to measure throughput and
+ * tail latency under interference between models.
+ *
+ * Models are trained on the same data by the code of their benchmarks,
+ * with those benchmarks' default parameters. Each model then serves its
+ * own open-loop stream of requests (see serving.hpp) concurrently with
+ * the others, with its predict calls executed in its arena.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <functional>
+#include <sstream>
+#include <algorithm>
+
+#include "tbb/task_arena.h"
+
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "serving.hpp"
+#include "decision_forest_clsf.hpp"
+#include "log_reg_lbfgs.hpp"
+#include "svm.hpp"
+
+
+struct tenant {
+    std::string name;
+    dm::NumericTablePtr X_nt;
+    std::function<dm::NumericTablePtr(dm::NumericTablePtr)> predict;
+};
+
+
+/*
+ * Partitions of n_threads threads among n_models models in multiples of
+ * step threads, each model getting at least one step.
+ */
+void enumerate_partitions(int n_threads, int n_models, int step,
+                          std::vector<int> &partition,
+                          std::vector<std::vector<int>> &partitions) {
+
+    int used = 0;
+    for (int t : partition)
+        used += t;
+
+    if ((int) partition.size() == n_models - 1) {
+        if (n_threads - used > 0) {
+            partition.push_back(n_threads - used);
+            partitions.push_back(partition);
+            partition.pop_back();
+        }
+        return;
+    }
+
+    int remaining = n_models - partition.size() - 1;
+    for (int t = step; used + t + remaining * step <= n_threads; t += step) {
+        partition.push_back(t);
+        enumerate_partitions(n_threads, n_models, step, partition,
+                             partitions);
+        partition.pop_back();
+    }
+
+}
+
+
+std::string partition_string(const std::vector<int> &partition) {
+
+    std::ostringstream s;
+    for (size_t i = 0; i < partition.size(); i++)
+        s << (i == 0 ? "" : "/") << partition[i];
+    return s.str();
+
+}
+
+
+/* Suffix of function names served with the given partition */
+std::string partition_suffix(const std::vector<int> &partition) {
+
+    std::ostringstream s;
+    s << ".partition";
+    for (int t : partition)
+        s << '_' << t;
+    return s.str();
+
+}
+
+
+/* Sorted response times in ms */
+std::vector<double> latencies_ms(const std::vector<double> &latencies) {
+
+    std::vector<double> ms(latencies);
+    for (auto &t : ms)
+        t *= 1e3;
+    std::sort(ms.begin(), ms.end());
+    return ms;
+
+}
+
+
+struct multi_tenant_bench {
+
+    static const char *description() {
+        return "Native benchmark of concurrent serving of several Intel(R) "
+               "DAAL models";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,models,function,partition,"
+               "model_threads,offered_qps,achieved_qps,p50_ms,p999_ms,"
+               "p99_ms";
+    }
+
+    std::string xfn, yfn;
+    std::vector<std::string> model_names = {"df_clsf", "log_reg", "svm"};
+    std::vector<int> partition;
+    bool search = false;
+    int search_step = 0;
+    struct serving_options serve_opts;
+
+    df_clsf_bench df_clsf;
+    log_reg_lbfgs_bench log_reg;
+    svm_bench svm;
+    std::vector<tenant> tenants;
+    int n_threads;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-x,--fileX,--file-X-train", xfn, "Feature file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        app.add_option("-y,--fileY,--file-y-train", yfn, "Labels file name")
+            ->required()
+            ->check(CLI::ExistingFile);
+
+        app.add_option("--models", model_names,
+                       "Models to serve concurrently", true)
+            ->check(CLI::IsMember({"df_clsf", "log_reg", "svm"}));
+
+        app.add_option("--partition", partition,
+                       "Threads of each model (default: an even split)");
+
+        app.add_flag("--search", search,
+                     "Search partitions of threads among models for the "
+                     "lowest worst-case p99 latency");
+
+        app.add_option("--search-step", search_step,
+                       "Granularity of threads in the search (default: "
+                       "an eighth of the threads)");
+
+        // Each model serves --serve-qps requests/s (one rate for all, or
+        // one per model)
+        add_serving_args(app, serve_opts);
+        serve_opts.qps = {100.};
+        serve_opts.duration = 2.;
+
+        // The models' own parameters keep their benchmarks' defaults
+        CLI::App model_app;
+        df_clsf.add_args(model_app);
+        log_reg.add_args(model_app);
+        svm.add_args(model_app);
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        n_threads = ctx.daal_threads;
+        if (serve_opts.qps.size() != 1
+            && serve_opts.qps.size() != model_names.size()) {
+            std::cerr << "error: --serve-qps needs one rate or one per model"
+                      << std::endl;
+            return false;
+        }
+        if (!partition.empty() && partition.size() != model_names.size()) {
+            std::cerr << "error: --partition needs threads for each model"
+                      << std::endl;
+            return false;
+        }
+        int partition_threads = 0;
+        for (int t : partition) {
+            if (t < 1) {
+                std::cerr << "error: --partition needs at least one thread "
+                          << "for each model" << std::endl;
+                return false;
+            }
+            partition_threads += t;
+        }
+        if (partition_threads > n_threads) {
+            std::cerr << "error: --partition uses " << partition_threads
+                      << " threads but only " << n_threads
+                      << " are available" << std::endl;
+            return false;
+        }
+        if ((int) model_names.size() > n_threads) {
+            std::cerr << "error: " << model_names.size() << " models need "
+                      << "at least as many threads" << std::endl;
+            return false;
+        }
+
+        for (auto &name : model_names) {
+            if (name == "df_clsf") {
+                df_clsf.xfn = xfn;
+                df_clsf.yfn = yfn;
+                if (!df_clsf.load(ctx))
+                    return false;
+            } else if (name == "log_reg") {
+                log_reg.xfn = xfn;
+                log_reg.yfn = yfn;
+                if (!log_reg.load(ctx))
+                    return false;
+            } else {
+                svm.xfn = xfn;
+                svm.yfn = yfn;
+                if (!svm.load(ctx))
+                    return false;
+            }
+        }
+
+        if (partition.empty()) {
+            for (size_t i = 0; i < model_names.size(); i++) {
+                partition.push_back(n_threads / model_names.size()
+                    + (i < n_threads % model_names.size() ? 1 : 0));
+            }
+        }
+        if (search_step <= 0)
+            search_step = std::max(n_threads / 8, 1);
+
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {
+        for (size_t i = 0; i < model_names.size(); i++)
+            os << (i == 0 ? "" : "/") << model_names[i];
+        os << ',';
+    }
+
+    /*
+     * Train every model with all threads.
+     */
+    void fit(bool verbose) {
+
+        for (auto &name : model_names) {
+            tenant t;
+            t.name = name;
+            if (name == "df_clsf") {
+                auto result = df_classification_fit(
+                        df_clsf.n_classes, df_clsf.params, df_clsf.X_nt,
+                        df_clsf.Y_nt, verbose);
+                int n_classes = df_clsf.n_classes;
+                t.X_nt = df_clsf.X_nt;
+                t.predict = [=](dm::NumericTablePtr X) {
+                    return df_classification_predict(n_classes, result, X,
+                                                     false);
+                };
+            } else if (name == "log_reg") {
+                auto result = logistic_regression_fit(
+                        log_reg.n_classes, log_reg.fit_intercept, log_reg.C,
+                        log_reg.max_iter, log_reg.tol, log_reg.X_nt,
+                        log_reg.Y_nt, verbose);
+                int n_classes = log_reg.n_classes;
+                t.X_nt = log_reg.X_nt;
+                t.predict = [=](dm::NumericTablePtr X) {
+                    return logistic_regression_predict(n_classes, result, X,
+                                                       false);
+                };
+            } else {
+                da::classifier::training::ResultPtr result;
+                std::tie(result, std::ignore) = svm_fit(
+                        svm.params, svm.X_nt, svm.Y_nt, svm.n_classes,
+                        verbose);
+                int n_classes = svm.n_classes;
+                svm_params params = svm.params;
+                t.X_nt = svm.X_nt;
+                t.predict = [=](dm::NumericTablePtr X) mutable {
+                    return svm_predict(params, result, X, n_classes, false);
+                };
+            }
+            tenants.push_back(t);
+        }
+
+    }
+
+    /*
+     * Serve all models concurrently with the given partition of threads,
+     * reporting each model and the aggregate. Returns the worst p99
+     * latency among the models.
+     */
+    double serve(bench_runner &runner, const std::vector<int> &threads) {
+
+        trace_span span("serve partition", partition_string(threads));
+        std::vector<serving_result> results(tenants.size());
+        std::vector<std::thread> streams;
+
+        for (size_t i = 0; i < tenants.size(); i++) {
+            streams.emplace_back([&, i] {
+                tbb::task_arena arena(threads[i]);
+                tenant &t = tenants[i];
+                auto predict = [&](dm::NumericTablePtr X) {
+                    dm::NumericTablePtr Y;
+                    arena.execute([&] { Y = t.predict(X); });
+                    return Y;
+                };
+
+                dm::BlockDescriptor<double> block;
+                size_t n_rows = t.X_nt->getNumberOfRows();
+                size_t n_cols = t.X_nt->getNumberOfColumns();
+                t.X_nt->getBlockOfRows(0, n_rows, dm::readOnly, block);
+                double qps = serve_opts.qps.size() == 1 ? serve_opts.qps[0]
+                                                        : serve_opts.qps[i];
+                results[i] = serve_open_loop(predict, block.getBlockPtr(),
+                                             n_rows, n_cols, qps,
+                                             serve_opts.max_wait[0],
+                                             serve_opts);
+                t.X_nt->releaseBlockOfRows(block);
+            });
+        }
+        for (auto &stream : streams)
+            stream.join();
+
+        // Each partition is stored under its own functions, with the
+        // response times of all requests as samples
+        std::string p = partition_string(threads);
+        std::string suffix = partition_suffix(threads);
+        double offered = 0., achieved = 0., worst_p99 = 0.;
+        std::vector<double> all_latencies;
+        for (size_t i = 0; i < tenants.size(); i++) {
+            serving_result &r = results[i];
+            runner.report_samples(tenants[i].name + ".serve" + suffix,
+                                  r.percentile(99) * 1e3,
+                                  latencies_ms(r.latencies), p, threads[i],
+                                  r.offered_qps, r.achieved_qps,
+                                  r.percentile(50) * 1e3,
+                                  r.percentile(99.9) * 1e3);
+            offered += r.offered_qps;
+            achieved += r.achieved_qps;
+            worst_p99 = std::max(worst_p99, r.percentile(99));
+            all_latencies.insert(all_latencies.end(), r.latencies.begin(),
+                                 r.latencies.end());
+        }
+        runner.report_samples("aggregate.serve" + suffix, worst_p99 * 1e3,
+                              latencies_ms(all_latencies), p, n_threads,
+                              offered, achieved, "", "");
+
+        return worst_p99;
+
+    }
+
+    void run(bench_runner &runner) {
+
+        fit(runner.verbose());
+
+        // One untimed request per model, so initialization isn't measured
+        for (auto &t : tenants) {
+            dm::BlockDescriptor<double> block;
+            t.X_nt->getBlockOfRows(0, 1, dm::readOnly, block);
+            t.predict(make_table(block.getBlockPtr(), 1,
+                                 t.X_nt->getNumberOfColumns()));
+            t.X_nt->releaseBlockOfRows(block);
+        }
+
+        if (!search) {
+            serve(runner, partition);
+            return;
+        }
+
+        std::vector<std::vector<int>> partitions;
+        std::vector<int> prefix;
+        enumerate_partitions(n_threads, tenants.size(), search_step, prefix,
+                             partitions);
+        if (runner.verbose()) {
+            std::cout << "@ Searching " << partitions.size()
+                      << " partitions of " << n_threads << " threads"
+                      << std::endl;
+        }
+
+        std::vector<int> best;
+        double best_p99 = 0.;
+        for (auto &threads : partitions) {
+            double p99 = serve(runner, threads);
+            if (best.empty() || p99 < best_p99) {
+                best = threads;
+                best_p99 = p99;
+            }
+        }
+        std::cout << "@ Best partition: " << partition_string(best)
+                  << " threads (" << model_names.size() << " models), "
+                  << "worst p99 " << best_p99 * 1e3 << " ms" << std::endl;
+
+    }
+
+};
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "multi_tenant.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    return run_benchmark<multi_tenant_bench>(argc, argv);
+
+}
@@ -0,0 +1,421 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Native benchmark of DAAL's multinomial naive Bayes on count features,
+ * as of bags of words.
+ *
+ * Training is timed in batch on a dense table, online on blocks of
+ * --block-rows rows, and in batch on a CSR table with the fastCSR
+ * method, and prediction on the dense and CSR tables. Throughput is
+ * reported in millions of nonzero counts per second, which is what the
+ * work scales with on sparse data.
+ *
+ * Without -x, counts are generated with --density nonzeros per row and
+ * feature, and labels are swept over --classes class counts: the label
+ * of a row is the block of features (of d / classes) which holds its
+ * largest count, so the classes can be learned.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "daal.h"
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "serving.hpp"
+
+namespace dmnb = da::multinomial_naive_bayes;
+
+
+/*
+ * Counts of an n x d matrix in CSR format, with one-based indices as
+ * DAAL's CSRNumericTable uses by default.
+ */
+struct count_matrix {
+    size_t rows, cols;
+    std::vector<double> values;
+    std::vector<size_t> col_indices;
+    std::vector<size_t> row_offsets;
+};
+
+
+/*
+ * Random counts with about density * d nonzeros in each row, of
+ * geometrically distributed values.
+ */
+count_matrix gen_counts(size_t n, size_t d, double density,
+                        unsigned seed) {
+
+    count_matrix counts;
+    counts.rows = n;
+    counts.cols = d;
+    counts.row_offsets.push_back(1);
+
+    std::mt19937_64 rng(seed);
+    std::binomial_distribution<size_t> row_nnz(d, density);
+    std::uniform_int_distribution<size_t> column(0, d - 1);
+    std::geometric_distribution<int> count(0.5);
+    std::vector<size_t> cols;
+
+    for (size_t i = 0; i < n; i++) {
+        cols.resize(std::max(row_nnz(rng), (size_t) 1));
+        for (auto &j : cols)
+            j = column(rng);
+        std::sort(cols.begin(), cols.end());
+        cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+        for (size_t j : cols) {
+            counts.values.push_back(1 + count(rng));
+            counts.col_indices.push_back(j + 1);
+        }
+        counts.row_offsets.push_back(counts.values.size() + 1);
+    }
+    return counts;
+
+}
+
+
+/*
+ * Counts of a dense n x d matrix.
+ */
+count_matrix dense_counts(const double *X, size_t n, size_t d) {
+
+    count_matrix counts;
+    counts.rows = n;
+    counts.cols = d;
+    counts.row_offsets.push_back(1);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < d; j++) {
+            if (X[i * d + j] != 0.) {
+                counts.values.push_back(X[i * d + j]);
+                counts.col_indices.push_back(j + 1);
+            }
+        }
+        counts.row_offsets.push_back(counts.values.size() + 1);
+    }
+    return counts;
+
+}
+
+
+std::vector<double> counts_to_dense(const count_matrix &counts) {
+
+    std::vector<double> X(counts.rows * counts.cols, 0.);
+    for (size_t i = 0; i < counts.rows; i++) {
+        for (size_t p = counts.row_offsets[i] - 1;
+             p < counts.row_offsets[i + 1] - 1; p++)
+            X[i * counts.cols + counts.col_indices[p] - 1] = counts.values[p];
+    }
+    return X;
+
+}
+
+
+/*
+ * Label of each row: the block of d / n_classes features holding its
+ * largest count.
+ */
+std::vector<double> block_labels(const count_matrix &counts,
+                                 size_t n_classes) {
+
+    std::vector<double> labels(counts.rows);
+    for (size_t i = 0; i < counts.rows; i++) {
+        size_t best = 0;
+        double best_count = -1.;
+        for (size_t p = counts.row_offsets[i] - 1;
+             p < counts.row_offsets[i + 1] - 1; p++) {
+            if (counts.values[p] > best_count) {
+                best_count = counts.values[p];
+                best = counts.col_indices[p] - 1;
+            }
+        }
+        labels[i] = std::min(best * n_classes / counts.cols, n_classes - 1);
+    }
+    return labels;
+
+}
+
+
+dm::NumericTablePtr csr_table(count_matrix &counts) {
+
+    return dm::CSRNumericTable::create(
+            counts.values.data(), counts.col_indices.data(),
+            counts.row_offsets.data(), counts.cols, counts.rows);
+
+}
+
+
+template <dmnb::training::Method method>
+dmnb::training::ResultPtr naive_bayes_fit(size_t n_classes,
+                                          dm::NumericTablePtr X,
+                                          dm::NumericTablePtr y) {
+
+    dmnb::training::Batch<double, method> algorithm(n_classes);
+    algorithm.input.set(da::classifier::training::data, X);
+    algorithm.input.set(da::classifier::training::labels, y);
+    algorithm.compute();
+    return algorithm.getResult();
+
+}
+
+
+/*
+ * Train on blocks of block_rows rows of the dense n x d matrix X at a
+ * time.
+ */
+dmnb::training::ResultPtr naive_bayes_fit_online(size_t n_classes,
+                                                 double *X, double *y,
+                                                 size_t n, size_t d,
+                                                 size_t block_rows) {
+
+    dmnb::training::Online<double, dmnb::training::defaultDense>
+        algorithm(n_classes);
+    for (size_t begin = 0; begin < n; begin += block_rows) {
+        size_t rows = std::min(block_rows, n - begin);
+        algorithm.input.set(da::classifier::training::data,
+                            make_table(X + begin * d, rows, d));
+        algorithm.input.set(da::classifier::training::labels,
+                            make_table(y + begin, rows, 1));
+        algorithm.compute();
+    }
+    algorithm.finalizeCompute();
+    return algorithm.getResult();
+
+}
+
+
+template <dmnb::prediction::Method method>
+dm::NumericTablePtr naive_bayes_predict(size_t n_classes,
+                                        dmnb::training::ResultPtr result,
+                                        dm::NumericTablePtr X) {
+
+    dmnb::prediction::Batch<double, method> algorithm(n_classes);
+    algorithm.input.set(da::classifier::prediction::data, X);
+    algorithm.input.set(da::classifier::prediction::model,
+                        result->get(da::classifier::training::model));
+    algorithm.compute();
+    return algorithm.getResult()->get(da::classifier::prediction::prediction);
+
+}
+
+
+struct naive_bayes_bench {
+
+    static const char *description() {
+        return "Native benchmark for Intel(R) DAAL multinomial naive Bayes";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,density,function,classes,"
+               "nnz,mnnz_per_s,accuracy,time";
+    }
+
+    struct timing_options fit_opts = {10, 100, 10., 10};
+    struct timing_options predict_opts = {10, 100, 10., 10};
+    struct serving_options serve_opts;
+    std::string stringSize = "50000x1000";
+    std::string xfn, yfn;
+    double density = 0.01;
+    unsigned seed = 777;
+    std::vector<size_t> class_counts = {2, 10, 100, 1000};
+    std::vector<std::string> modes = {"batch", "online", "csr"};
+    size_t block_rows = 10000;
+
+    std::vector<int> size;
+    count_matrix counts;
+    std::vector<double> X_dense, y_file;
+    dm::NumericTablePtr X_nt, X_csr;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-s,--size", stringSize,
+                       "Problem size of generated counts", true);
+
+        app.add_option("-x,--fileX,--file-X-train", xfn,
+                       "Dense count feature file name (random counts are "
+                       "used if not given)")
+            ->check(CLI::ExistingFile);
+        app.add_option("-y,--fileY,--file-y-train", yfn,
+                       "Labels file name (needed with -x)")
+            ->check(CLI::ExistingFile);
+
+        add_timing_args(app, "fit", fit_opts);
+        add_timing_args(app, "predict", predict_opts);
+        add_serving_args(app, serve_opts);
+
+        app.add_option("--density", density,
+                       "Fraction of nonzero counts of generated rows", true)
+            ->check(CLI::Range(1e-6, 1.));
+
+        app.add_option("--seed", seed, "Seed for generated counts", true);
+
+        app.add_option("--classes", class_counts,
+                       "Class counts of generated labels to sweep", true)
+            ->check(CLI::Range(2, 100000));
+
+        app.add_option("--modes", modes,
+                       "Training modes: batch on a dense table, online on "
+                       "blocks of it, or batch on a CSR table", true)
+            ->check(CLI::IsMember({"batch", "online", "csr"}));
+
+        app.add_option("--block-rows", block_rows,
+                       "Rows of each block given to online training", true)
+            ->check(CLI::PositiveNumber);
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        if (!xfn.empty()) {
+            if (yfn.empty()) {
+                std::cerr << "error: -x needs labels given with -y"
+                          << std::endl;
+                return false;
+            }
+            struct npyarr *arrX = load_array(xfn, 2, "X");
+            struct npyarr *arrY = load_array(yfn, 1, "y", "i8");
+            if (!arrX || !arrY)
+                return false;
+            if (arrY->shape[0] != arrX->shape[0]) {
+                std::cerr << "error: X has " << arrX->shape[0]
+                          << " rows but y has " << arrY->shape[0]
+                          << std::endl;
+                return false;
+            }
+            size.assign(arrX->shape, arrX->shape + 2);
+            counts = dense_counts((double *) arrX->data, size[0], size[1]);
+            int64_t *y = (int64_t *) arrY->data;
+            y_file.assign(y, y + size[0]);
+            std::ostringstream string_size_stream;
+            string_size_stream << size[0] << 'x' << size[1];
+            stringSize = string_size_stream.str();
+            class_counts = {(size_t) count_classes(
+                    make_table(y_file.data(), size[0], 1))};
+            density = (double) counts.values.size() / size[0] / size[1];
+        } else {
+            parse_size(stringSize, size);
+            check_dims(size, 2);
+            counts = gen_counts(size[0], size[1], density, seed);
+            for (size_t n_classes : class_counts) {
+                if (n_classes > (size_t) size[1]) {
+                    std::cerr << "warning: only " << size[1] << " of "
+                              << n_classes << " classes can have rows with "
+                              << size[1] << " features" << std::endl;
+                }
+            }
+        }
+
+        trace_span span("make_table");
+        X_dense = counts_to_dense(counts);
+        X_nt = make_table(X_dense.data(), counts.rows, counts.cols);
+        X_csr = csr_table(counts);
+
+        ctx.size = stringSize;
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {
+        os << density << ',';
+    }
+
+    /*
+     * Report function with a suffix of the class count, e.g.
+     * MultinomialNB.fit.classes_10, so that the results store doesn't
+     * pool class counts.
+     */
+    template <typename Accuracy>
+    void report(bench_runner &runner, const std::string &function,
+                double time, size_t n_classes, const Accuracy &accuracy) {
+
+        double nnz = counts.values.size();
+        runner.report(function + classes_suffix(n_classes), time,
+                      n_classes, nnz, nnz / time * 1e-6, accuracy);
+
+    }
+
+    static std::string classes_suffix(size_t n_classes) {
+        return ".classes_" + std::to_string(n_classes);
+    }
+
+    void run(bench_runner &runner) {
+
+        size_t n = counts.rows, d = counts.cols;
+        for (size_t n_classes : class_counts) {
+            std::vector<double> y = y_file.empty()
+                ? block_labels(counts, n_classes) : y_file;
+            auto y_nt = make_table(y.data(), n, 1);
+            double time;
+            dmnb::training::ResultPtr result;
+
+            if (std::find(modes.begin(), modes.end(), "online")
+                != modes.end()) {
+                std::tie(time, result) = runner.time([&] {
+                        return naive_bayes_fit_online(
+                                n_classes, X_dense.data(), y.data(), n, d,
+                                block_rows);
+                    }, fit_opts);
+                report(runner, "MultinomialNB.fit_online", time, n_classes,
+                       "");
+            }
+
+            if (std::find(modes.begin(), modes.end(), "csr")
+                != modes.end()) {
+                std::tie(time, result) = runner.time([&] {
+                        return naive_bayes_fit<dmnb::training::fastCSR>(
+                                n_classes, X_csr, y_nt);
+                    }, fit_opts);
+                report(runner, "MultinomialNB.fit_csr", time, n_classes, "");
+
+                dm::NumericTablePtr yp_nt;
+                std::tie(time, yp_nt) = runner.time([&] {
+                        return naive_bayes_predict<
+                            dmnb::prediction::fastCSR>(n_classes, result,
+                                                       X_csr);
+                    }, predict_opts);
+                report(runner, "MultinomialNB.predict_csr", time, n_classes,
+                       accuracy_score(y_nt, yp_nt) * 100.);
+            }
+
+            if (std::find(modes.begin(), modes.end(), "batch")
+                != modes.end()) {
+                std::tie(time, result) = runner.time([&] {
+                        return naive_bayes_fit<
+                            dmnb::training::defaultDense>(n_classes, X_nt,
+                                                          y_nt);
+                    }, fit_opts);
+                report(runner, "MultinomialNB.fit", time, n_classes, "");
+            }
+
+            dm::NumericTablePtr yp_nt;
+            std::tie(time, yp_nt) = runner.time([&] {
+                    return naive_bayes_predict<
+                        dmnb::prediction::defaultDense>(n_classes, result,
+                                                        X_nt);
+                }, predict_opts);
+            report(runner, "MultinomialNB.predict", time, n_classes,
+                   accuracy_score(y_nt, yp_nt) * 100.);
+
+            std::string serve_function = "MultinomialNB.serve"
+                                         + classes_suffix(n_classes);
+            runner.serve(serve_function, [&](dm::NumericTablePtr X) {
+                    return naive_bayes_predict<
+                        dmnb::prediction::defaultDense>(n_classes, result,
+                                                        X);
+                }, X_nt, serve_opts);
+        }
+
+    }
+
+};
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "naive_bayes.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    return run_benchmark<naive_bayes_bench>(argc, argv);
+
+}
@@ -11,6 +11,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifndef _NPYFILE_H_
 #define _NPYFILE_H_
@@ -18,12 +23,19 @@
 #define NPY_VERSION 0x0200
 static const char NPY_HEADER[] = "\x93NUMPY";
 
+/* Shared memory arrays: a header followed by the data at a page boundary */
+#define NPY_SHM_MAGIC "NPYSHM1"
+#define NPY_SHM_MAX_DIMS 8
+#define NPY_SHM_DESCR_LEN 16
+#define NPY_SHM_DATA_OFFSET 4096
+
 struct npyarr {
     char *descr; /* dtype descriptor */
     bool fortran_order; /* is this array F-contiguous? */
     size_t shape_len; /* number of dimensions in shape */
     size_t *shape; /* shape of array */
     void *data; /* the actual array */
+    size_t mapped_size; /* if nonzero, data is in a shared memory mapping */
 };
 
 
@@ -35,7 +47,10 @@ void free_npy(struct npyarr *arr) {
         if (arr->descr != NULL) {
             free(arr->descr);
         }
-        if (arr->data != NULL) {
+        if (arr->data != NULL && arr->mapped_size > 0) {
+            munmap((char *) arr->data - NPY_SHM_DATA_OFFSET,
+                   arr->mapped_size);
+        } else if (arr->data != NULL) {
             free(arr->data);
         }
         free(arr);
@@ -110,6 +125,8 @@ struct npyarr *load_npy(const char *path) {
     arr->shape_len = 0;
     arr->shape = NULL;
     arr->descr = NULL;
+    arr->data = NULL;
+    arr->mapped_size = 0;
     long shape_loc;
     unsigned int shape_i = 0;
     unsigned int descr_i = 0;
@@ -383,4 +400,209 @@ void save_npy(const struct npyarr *arr, const char *path, size_t elem_size) {
 
 }
 
+/*
+ * Header of an array in shared memory. The array data starts
+ * NPY_SHM_DATA_OFFSET bytes after the start of the header.
+ */
+struct npyshm_header {
+    char magic[8]; /* NPY_SHM_MAGIC, written last */
+    char descr[NPY_SHM_DESCR_LEN]; /* dtype descriptor */
+    bool fortran_order; /* is this array F-contiguous? */
+    size_t shape_len; /* number of dimensions in shape */
+    size_t shape[NPY_SHM_MAX_DIMS]; /* shape of array */
+    size_t data_size; /* size of the array data in bytes */
+    long long source_mtime; /* modification time of the source file */
+    long long source_size; /* size of the source file */
+};
+
+
+/*
+ * Get the size in bytes of an element of the given dtype descriptor,
+ * e.g. 8 for "<f8". Returns 0 for descriptors we don't understand.
+ */
+size_t npy_elem_size(const char *descr) {
+
+    if (descr == NULL || strlen(descr) < 3) {
+        return 0;
+    }
+    return (size_t) atoi(descr + 2);
+
+}
+
+
+/*
+ * Get the name of the shared memory object holding the array loaded from
+ * the given npy file. Names are derived from the absolute path so that all
+ * processes agree on them.
+ */
+void shared_npy_name(const char *path, char *name, size_t len) {
+
+    char abs_path[PATH_MAX];
+    if (realpath(path, abs_path) == NULL) {
+        strncpy(abs_path, path, PATH_MAX - 1);
+        abs_path[PATH_MAX - 1] = '\0';
+    }
+
+    /* shared memory object names are "/" followed by a file name */
+    snprintf(name, len, "/npy%s", abs_path);
+    for (char *c = name + 1; *c != '\0'; c++) {
+        if (*c == '/') {
+            *c = '_';
+        }
+    }
+
+}
+
+
+/*
+ * Copy an array to a new shared memory object with the given name,
+ * replacing any existing object with that name. If source_path is given,
+ * its size and modification time are recorded so that readers can detect
+ * stale copies. Returns 0 on success.
+ */
+int save_shared(const struct npyarr *arr, const char *name,
+                const char *source_path) {
+
+    if (arr == NULL || name == NULL || arr->shape_len > NPY_SHM_MAX_DIMS
+            || strlen(arr->descr) >= NPY_SHM_DESCR_LEN) {
+        return -1;
+    }
+
+    size_t data_size = npy_elem_size(arr->descr);
+    for (size_t i = 0; i < arr->shape_len; i++) {
+        data_size *= arr->shape[i];
+    }
+    size_t mapped_size = NPY_SHM_DATA_OFFSET + data_size;
+
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    if (source_path != NULL && stat(source_path, &st) != 0) {
+        return -1;
+    }
+
+    /* readers which already mapped the old object keep their copy */
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, mapped_size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    char *base = (char *) mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name);
+        return -1;
+    }
+
+    struct npyshm_header *header = (struct npyshm_header *) base;
+    strcpy(header->descr, arr->descr);
+    header->fortran_order = arr->fortran_order;
+    header->shape_len = arr->shape_len;
+    for (size_t i = 0; i < arr->shape_len; i++) {
+        header->shape[i] = arr->shape[i];
+    }
+    header->data_size = data_size;
+    header->source_mtime = (long long) st.st_mtime;
+    header->source_size = (long long) st.st_size;
+    memcpy(base + NPY_SHM_DATA_OFFSET, arr->data, data_size);
+
+    /* only now is the object complete */
+    memcpy(header->magic, NPY_SHM_MAGIC, sizeof(header->magic));
+    munmap(base, mapped_size);
+
+    return 0;
+
+}
+
+
+/*
+ * Map the array in the shared memory object with the given name without
+ * copying it. The mapping is private, so writes to the array are not seen
+ * by other processes. Returns NULL if there is no complete array with that
+ * name. Free the array with free_npy.
+ */
+struct npyarr *load_shared(const char *name) {
+
+    if (name == NULL) {
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < NPY_SHM_DATA_OFFSET) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t mapped_size = st.st_size;
+    char *base = (char *) mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    struct npyshm_header *header = (struct npyshm_header *) base;
+    if (memcmp(header->magic, NPY_SHM_MAGIC, sizeof(header->magic)) != 0
+            || header->shape_len > NPY_SHM_MAX_DIMS
+            || NPY_SHM_DATA_OFFSET + header->data_size > mapped_size) {
+        munmap(base, mapped_size);
+        return NULL;
+    }
+
+    struct npyarr *arr = (struct npyarr *) malloc(sizeof(*arr));
+    arr->descr = strdup(header->descr);
+    arr->fortran_order = header->fortran_order;
+    arr->shape_len = header->shape_len;
+    arr->shape = (size_t *) calloc(arr->shape_len, sizeof(*arr->shape));
+    for (size_t i = 0; i < arr->shape_len; i++) {
+        arr->shape[i] = header->shape[i];
+    }
+    arr->data = base + NPY_SHM_DATA_OFFSET;
+    arr->mapped_size = mapped_size;
+
+    return arr;
+
+}
+
+
+/*
+ * Map the shared memory copy of the given npy file, if one was made
+ * (e.g. by dsload) and the file hasn't changed since. Returns NULL
+ * otherwise.
+ */
+struct npyarr *load_shared_npy(const char *path) {
+
+    char name[PATH_MAX + 8];
+    shared_npy_name(path, name, sizeof(name));
+
+    struct npyarr *arr = load_shared(name);
+    if (arr == NULL) {
+        return NULL;
+    }
+
+    struct stat st;
+    struct npyshm_header *header = (struct npyshm_header *)
+        ((char *) arr->data - NPY_SHM_DATA_OFFSET);
+    if (stat(path, &st) != 0
+            || header->source_mtime != (long long) st.st_mtime
+            || header->source_size != (long long) st.st_size) {
+        free_npy(arr);
+        return NULL;
+    }
+
+    return arr;
+
+}
+
 #endif /* _NPYFILE_H_ */
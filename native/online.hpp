@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Latency of updating models incrementally with DAAL's Online algorithms,
+ * as models refreshed with a few thousand new rows at a time are, instead
+ * of refitting them on all rows.
+ *
+ * For each algorithm and each --batch-rows size, a long-lived Online
+ * algorithm is given the first --initial-fraction of rows, and then
+ * --updates batches of new rows, appended one after another from the
+ * rest of the data (wrapping around when it runs out). After each batch,
+ * compute() (updating the partial result) and finalizeCompute()
+ * (computing the model from it) are timed separately. A Batch algorithm
+ * refitting all rows seen so far is timed for comparison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <tuple>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "daal.h"
+#include "CLI11.hpp"
+#include "common.hpp"
+#include "benchmark.hpp"
+#include "serving.hpp"
+
+namespace dal = da::linear_regression;
+namespace dar = da::ridge_regression;
+namespace dcov = da::covariance;
+namespace dlom = da::low_order_moments;
+
+
+/*
+ * An Online algorithm, with the Batch algorithm it is compared to. y is
+ * only used by regressions.
+ */
+struct online_algorithm {
+    std::function<void(dm::NumericTablePtr X, dm::NumericTablePtr y)> update;
+    std::function<void()> finalize;
+    std::function<void(dm::NumericTablePtr X, dm::NumericTablePtr y)> refit;
+};
+
+
+/*
+ * A new Online algorithm of the given name: linear, ridge, covariance,
+ * moments or pca (correlation method).
+ */
+online_algorithm make_online(const std::string &algorithm) {
+
+    online_algorithm online;
+    if (algorithm == "linear") {
+        auto alg = std::make_shared<
+            dal::training::Online<double, dal::training::normEqDense>>();
+        online.update = [=](dm::NumericTablePtr X, dm::NumericTablePtr y) {
+            alg->input.set(dal::training::data, X);
+            alg->input.set(dal::training::dependentVariables, y);
+            alg->compute();
+        };
+        online.finalize = [=] { alg->finalizeCompute(); };
+        online.refit = [](dm::NumericTablePtr X, dm::NumericTablePtr y) {
+            dal::training::Batch<double, dal::training::normEqDense> batch;
+            batch.input.set(dal::training::data, X);
+            batch.input.set(dal::training::dependentVariables, y);
+            batch.compute();
+        };
+    } else if (algorithm == "ridge") {
+        auto alg = std::make_shared<
+            dar::training::Online<double, dar::training::normEqDense>>();
+        online.update = [=](dm::NumericTablePtr X, dm::NumericTablePtr y) {
+            alg->input.set(dar::training::data, X);
+            alg->input.set(dar::training::dependentVariables, y);
+            alg->compute();
+        };
+        online.finalize = [=] { alg->finalizeCompute(); };
+        online.refit = [](dm::NumericTablePtr X, dm::NumericTablePtr y) {
+            dar::training::Batch<double, dar::training::normEqDense> batch;
+            batch.input.set(dar::training::data, X);
+            batch.input.set(dar::training::dependentVariables, y);
+            batch.compute();
+        };
+    } else if (algorithm == "covariance") {
+        auto alg = std::make_shared<
+            dcov::Online<double, dcov::defaultDense>>();
+        online.update = [=](dm::NumericTablePtr X, dm::NumericTablePtr) {
+            alg->input.set(dcov::data, X);
+            alg->compute();
+        };
+        online.finalize = [=] { alg->finalizeCompute(); };
+        online.refit = [](dm::NumericTablePtr X, dm::NumericTablePtr) {
+            dcov::Batch<double, dcov::defaultDense> batch;
+            batch.input.set(dcov::data, X);
+            batch.compute();
+        };
+    } else if (algorithm == "moments") {
+        auto alg = std::make_shared<
+            dlom::Online<double, dlom::defaultDense>>();
+        online.update = [=](dm::NumericTablePtr X, dm::NumericTablePtr) {
+            alg->input.set(dlom::data, X);
+            alg->compute();
+        };
+        online.finalize = [=] { alg->finalizeCompute(); };
+        online.refit = [](dm::NumericTablePtr X, dm::NumericTablePtr) {
+            dlom::Batch<double, dlom::defaultDense> batch;
+            batch.input.set(dlom::data, X);
+            batch.compute();
+        };
+    } else {
+        auto alg = std::make_shared<
+            da::pca::Online<double, da::pca::correlationDense>>();
+        online.update = [=](dm::NumericTablePtr X, dm::NumericTablePtr) {
+            alg->input.set(da::pca::data, X);
+            alg->compute();
+        };
+        online.finalize = [=] { alg->finalizeCompute(); };
+        online.refit = [](dm::NumericTablePtr X, dm::NumericTablePtr) {
+            da::pca::Batch<double, da::pca::correlationDense> batch;
+            batch.input.set(da::pca::data, X);
+            batch.compute();
+        };
+    }
+    return online;
+
+}
+
+
+/*
+ * Function names of each algorithm, as in their batch benchmarks.
+ */
+std::string online_function_prefix(const std::string &algorithm) {
+
+    if (algorithm == "linear")
+        return "Linear";
+    if (algorithm == "ridge")
+        return "Ridge";
+    if (algorithm == "covariance")
+        return "Covariance";
+    if (algorithm == "moments")
+        return "Moments";
+    return "PCA";
+
+}
+
+
+struct online_latencies {
+    std::vector<double> update;    // Sorted, in seconds
+    std::vector<double> finalize;  // Sorted, in seconds
+    size_t rows;                   // Rows seen after the last update
+};
+
+
+double latency_mean(const std::vector<double> &latencies) {
+
+    double sum = 0.;
+    for (double t : latencies)
+        sum += t;
+    return latencies.empty() ? 0. : sum / latencies.size();
+
+}
+
+
+/*
+ * Give a new Online algorithm the first n_initial of the n x d rows of X
+ * (and n x k of y), then n_updates batches of batch_rows of the other
+ * rows, timing the update and finalization of each batch.
+ */
+online_latencies time_online_updates(const std::string &algorithm,
+                                     double *X, double *y, size_t n,
+                                     size_t d, size_t k, size_t n_initial,
+                                     size_t batch_rows, size_t n_updates) {
+
+    typedef std::chrono::steady_clock clock;
+    trace_span span("time_online_updates", algorithm);
+    online_algorithm online = make_online(algorithm);
+    online.update(make_table(X, n_initial, d), make_table(y, n_initial, k));
+    online.finalize();
+
+    online_latencies latencies;
+    latencies.rows = n_initial;
+    size_t next = n_initial;
+    for (size_t u = 0; u < n_updates; u++) {
+        if (next + batch_rows > n)
+            next = n_initial;
+        auto X_batch = make_table(X + next * d, batch_rows, d);
+        auto y_batch = make_table(y + next * k, batch_rows, k);
+        next += batch_rows;
+
+        auto t0 = clock::now();
+        online.update(X_batch, y_batch);
+        auto t1 = clock::now();
+        online.finalize();
+        auto t2 = clock::now();
+
+        latencies.update.push_back(
+                std::chrono::duration<double>(t1 - t0).count());
+        latencies.finalize.push_back(
+                std::chrono::duration<double>(t2 - t1).count());
+        latencies.rows += batch_rows;
+    }
+
+    std::sort(latencies.update.begin(), latencies.update.end());
+    std::sort(latencies.finalize.begin(), latencies.finalize.end());
+    return latencies;
+
+}
+
+
+struct online_bench {
+
+    static const char *description() {
+        return "Native benchmark of incremental updates of Intel(R) DAAL "
+               "models with Online algorithms";
+    }
+
+    static const char *header() {
+        return "batch,arch,prefix,threads,size,function,batch_rows,rows,"
+               "p50_ms,max_ms,time";
+    }
+
+    std::string stringSize = "1000000x50";
+    std::string xfn, yfn;
+    std::vector<std::string> algorithms = {"linear", "ridge", "covariance",
+                                           "moments", "pca"};
+    std::vector<size_t> batch_rows = {100, 1000, 10000};
+    size_t updates = 50;
+    double initial_fraction = 0.5;
+    struct timing_options refit_opts = {10, 100, 10., 10};
+
+    std::vector<int> size, y_size;
+    double *X, *y;
+
+    void add_args(CLI::App &app) {
+
+        app.add_option("-s,--size", stringSize, "Problem size");
+
+        app.add_option("-x,--fileX,--file-X-train", xfn,
+                       "Feature file name (random data is used if not given)")
+            ->check(CLI::ExistingFile);
+        app.add_option("-y,--fileY,--file-y-train", yfn,
+                       "Target file name for regressions (random data is "
+                       "used if not given)")
+            ->check(CLI::ExistingFile);
+
+        app.add_option("--algorithms", algorithms,
+                       "Online algorithms to update", true)
+            ->check(CLI::IsMember({"linear", "ridge", "covariance",
+                                   "moments", "pca"}));
+
+        app.add_option("--batch-rows", batch_rows,
+                       "Rows of each update, timed for each size", true)
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--updates", updates,
+                       "Updates to time for each batch size", true)
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--initial-fraction", initial_fraction,
+                       "Fraction of rows the models are built on before "
+                       "updates", true)
+            ->check(CLI::Range(0.01, 0.99));
+
+        add_timing_args(app, "refit", refit_opts);
+
+    }
+
+    bool load(bench_context &ctx) {
+
+        X = load_or_gen_random(xfn, size, stringSize);
+        if (!X)
+            return false;
+        std::string yStringSize = std::to_string(size[0]) + "x1";
+        y = load_or_gen_random(yfn, y_size, yStringSize);
+        if (!y)
+            return false;
+        if (y_size[0] != size[0]) {
+            std::cerr << "error: X has " << size[0] << " rows but y has "
+                      << y_size[0] << std::endl;
+            return false;
+        }
+
+        size_t n = size[0], n_initial = n * initial_fraction;
+        for (size_t rows : batch_rows) {
+            if (rows > n - n_initial) {
+                std::cerr << "error: updates of " << rows << " rows need "
+                          << "more than the " << n - n_initial
+                          << " rows left after the initial fraction"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        ctx.size = stringSize;
+        return true;
+
+    }
+
+    void write_meta(std::ostream &os) {}
+
+    void run(bench_runner &runner) {
+
+        size_t n = size[0], d = size[1], k = y_size[1];
+        size_t n_initial = n * initial_fraction;
+
+        for (auto &algorithm : algorithms) {
+            std::string prefix = online_function_prefix(algorithm);
+            for (size_t rows : batch_rows) {
+                // Each batch size is stored under its own functions, with
+                // the latency of each update as samples
+                std::string suffix = ".rows_" + std::to_string(rows);
+                online_latencies l = time_online_updates(
+                        algorithm, X, y, n, d, k, n_initial, rows, updates);
+                runner.report_samples(prefix + ".online_update" + suffix,
+                                      latency_mean(l.update), l.update,
+                                      rows, l.rows,
+                                      nearest_rank_percentile(l.update, 50)
+                                      * 1e3,
+                                      l.update.back() * 1e3);
+                runner.report_samples(prefix + ".online_finalize" + suffix,
+                                      latency_mean(l.finalize), l.finalize,
+                                      rows, l.rows,
+                                      nearest_rank_percentile(l.finalize, 50)
+                                      * 1e3,
+                                      l.finalize.back() * 1e3);
+
+                // Refit as many of the rows the model has seen as there
+                // are
+                size_t refit_rows = std::min(l.rows, n);
+                online_algorithm online = make_online(algorithm);
+                double time;
+                std::tie(time, std::ignore) = runner.time([&] {
+                        online.refit(make_table(X, refit_rows, d),
+                                     make_table(y, refit_rows, k));
+                        return 0;
+                    }, refit_opts);
+                runner.report(prefix + ".refit" + suffix, time, rows,
+                              refit_rows, "", "");
+
+                if (runner.verbose()) {
+                    double update = latency_mean(l.update)
+                                    + latency_mean(l.finalize);
+                    std::cout << "@ " << prefix << " updates of " << rows
+                              << " rows: " << update * 1e3 << " ms with "
+                              << "finalization, "
+                              << update / time * 100. << "% of a "
+                              << time * 1e3 << " ms refit" << std::endl;
+                }
+            }
+        }
+
+    }
+
+};
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "online.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+    return run_benchmark<online_bench>(argc, argv);
+
+}
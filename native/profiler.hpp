@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * In-process sampling profiler, for finding hotspots (e.g. which DAAL
+ * kernel dominates a phase) on hosts where perf can't be attached.
+ *
+ * While a phase is timed, every thread of the calling thread's TBB arena
+ * gets a timer on its own CPU time clock which sends it SIGPROF every
+ * sampling period. The signal handler records the interrupted
+ * instruction and the call stack into a preallocated buffer, without
+ * locks or allocation. Stacks are symbolized with dladdr and summarized
+ * when each phase ends, emptying the buffer for the next phase, so each
+ * phase has the whole buffer to itself. Functions of the executable
+ * itself are only named if it was linked with -rdynamic.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <sys/syscall.h>
+
+#if !defined(TBB_PREVIEW_LOCAL_OBSERVER)
+#define TBB_PREVIEW_LOCAL_OBSERVER 1
+#endif
+#include "tbb/task_scheduler_observer.h"
+#include "tbb/task_arena.h"
+#if __has_include("tbb/version.h")
+#include "tbb/version.h"
+#else
+#include "tbb/tbb_stddef.h"
+#endif
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+
+#define PROFILE_MAX_DEPTH 32
+#define PROFILE_MAX_SAMPLES (1 << 16)
+
+struct profile_sample {
+    int phase;
+    int depth;
+    void *frames[PROFILE_MAX_DEPTH];
+};
+
+static profile_sample *profile_samples = NULL;
+static std::atomic<size_t> profile_n_samples(0);
+static std::atomic<size_t> profile_n_dropped(0);
+// Index of the phase being sampled, or -1 when not sampling
+static std::atomic<int> profile_phase(-1);
+
+
+/*
+ * Per-thread CPU time timer delivering SIGPROF to its thread.
+ */
+struct profile_timer {
+    timer_t id;
+    bool created = false;
+
+    void arm(long period_ns) {
+        if (!created) {
+            struct sigevent sev;
+            memset(&sev, 0, sizeof(sev));
+            sev.sigev_notify = SIGEV_THREAD_ID;
+            sev.sigev_signo = SIGPROF;
+            sev.sigev_notify_thread_id = syscall(SYS_gettid);
+            if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &id) != 0)
+                return;
+            created = true;
+        }
+        struct itimerspec spec;
+        spec.it_interval.tv_sec = period_ns / 1000000000;
+        spec.it_interval.tv_nsec = period_ns % 1000000000;
+        spec.it_value = spec.it_interval;
+        timer_settime(id, 0, &spec, NULL);
+    }
+
+    void disarm() {
+        if (!created)
+            return;
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        timer_settime(id, 0, &spec, NULL);
+    }
+};
+
+profile_timer &this_thread_profile_timer() {
+    thread_local profile_timer timer;
+    return timer;
+}
+
+
+void profile_signal_handler(int sig, siginfo_t *info, void *ucontext) {
+
+    if (profile_phase.load(std::memory_order_relaxed) < 0) {
+        // Workers which were in the arena when sampling stopped
+        this_thread_profile_timer().disarm();
+        return;
+    }
+
+    size_t i = profile_n_samples.fetch_add(1, std::memory_order_relaxed);
+    if (i >= PROFILE_MAX_SAMPLES) {
+        profile_n_dropped++;
+        return;
+    }
+
+    int saved_errno = errno;
+    profile_sample &s = profile_samples[i];
+    s.phase = profile_phase.load(std::memory_order_relaxed);
+
+    // The leaf is the interrupted instruction. The unwound stack starts
+    // with this handler and the signal trampoline, which are skipped.
+    void *stack[PROFILE_MAX_DEPTH + 2];
+    int depth = backtrace(stack, PROFILE_MAX_DEPTH + 2);
+    s.frames[0] = (void *)
+        ((ucontext_t *) ucontext)->uc_mcontext.gregs[REG_RIP];
+    s.depth = 1;
+    for (int j = 3; j < depth && s.depth < PROFILE_MAX_DEPTH; j++)
+        s.frames[s.depth++] = stack[j];
+    errno = saved_errno;
+
+}
+
+
+/*
+ * Name of the function containing the given address.
+ */
+std::string symbolize(void *addr) {
+
+    Dl_info info;
+    if (!dladdr(addr, &info))
+        return "??";
+    if (!info.dli_sname) {
+        const char *object = strrchr(info.dli_fname, '/');
+        return std::string("?? (") + (object ? object + 1 : info.dli_fname)
+            + ")";
+    }
+
+    int status;
+    char *demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL,
+                                          &status);
+    std::string name = status == 0 ? demangled : info.dli_sname;
+    free(demangled);
+    return name;
+
+}
+
+
+class sampling_profiler : public tbb::task_scheduler_observer {
+
+    public:
+        // Observe the arena of the thread calling start()
+#if TBB_INTERFACE_VERSION >= 12000
+        sampling_profiler() : tbb::task_scheduler_observer() {}
+#else
+        sampling_profiler() : tbb::task_scheduler_observer(true) {}
+#endif
+
+        ~sampling_profiler() { observe(false); }
+
+        /*
+         * Install the signal handler, sampling every period_ns of CPU
+         * time of each thread.
+         */
+        void init(long period_ns) {
+
+            this->period_ns = period_ns;
+            if (!profile_samples)
+                profile_samples = new profile_sample[PROFILE_MAX_SAMPLES];
+
+            // The first call of backtrace may allocate, so it can't
+            // happen in the signal handler
+            void *frame;
+            backtrace(&frame, 1);
+
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_sigaction = profile_signal_handler;
+            sa.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            sigaction(SIGPROF, &sa, NULL);
+
+        }
+
+        /*
+         * Start sampling a new phase, named later by name_phase.
+         */
+        void start() {
+
+            // A phase timed without being reported is left unnamed
+            summarize();
+            phases.push_back(phase_profile());
+            pending = true;
+            profile_phase = phases.size() - 1;
+            observe(true);
+            this_thread_profile_timer().arm(period_ns);
+
+        }
+
+        void stop() {
+
+            this_thread_profile_timer().disarm();
+            profile_phase = -1;
+            observe(false);
+
+        }
+
+        /*
+         * Name the last phase sampled and summarize its samples, if it
+         * hasn't been named yet.
+         */
+        void name_phase(const std::string &name) {
+
+            if (!pending)
+                return;
+            phases.back().name = name;
+            summarize();
+
+        }
+
+        /*
+         * Print the top_n functions by samples where they are the leaf
+         * (self) and anywhere in the stack (total) for each phase, then
+         * discard them.
+         */
+        void report(int top_n) {
+
+            summarize();
+            for (auto &phase : phases) {
+                std::string name = phase.name.empty() ? "(unnamed)"
+                                                      : phase.name;
+                std::cout << "@ " << name << " profile: " << phase.samples
+                          << " samples" << std::endl;
+                print_top("self", phase.self, phase.samples, top_n);
+                print_top("total", phase.total, phase.samples, top_n);
+                if (phase.dropped > 0) {
+                    std::cerr << "warning: profile buffer full, dropped "
+                              << phase.dropped << " samples of " << name
+                              << std::endl;
+                }
+            }
+            phases.clear();
+
+        }
+
+        void on_scheduler_entry(bool is_worker) override {
+            if (is_worker)
+                this_thread_profile_timer().arm(period_ns);
+        }
+
+        void on_scheduler_exit(bool is_worker) override {
+            if (is_worker)
+                this_thread_profile_timer().disarm();
+        }
+
+    private:
+        struct phase_profile {
+            std::string name;
+            size_t samples = 0;
+            size_t dropped = 0;
+            std::map<std::string, size_t> self, total;
+        };
+
+        long period_ns = 1000000;
+        std::vector<phase_profile> phases;
+        bool pending = false;  // The last phase's samples are in the buffer
+        std::map<void *, std::string> names;
+
+        /*
+         * Count the samples of the last phase by function and empty the
+         * buffer for the next phase.
+         */
+        void summarize() {
+
+            if (!pending)
+                return;
+            pending = false;
+
+            phase_profile &phase = phases.back();
+            int p = phases.size() - 1;
+            size_t n = std::min(profile_n_samples.load(),
+                                (size_t) PROFILE_MAX_SAMPLES);
+            for (size_t i = 0; i < n; i++) {
+                profile_sample &s = profile_samples[i];
+                // Skip samples of an earlier phase written by a handler
+                // which was still running when it stopped
+                if (s.phase != p)
+                    continue;
+                phase.samples++;
+                std::set<std::string> seen;
+                for (int j = 0; j < s.depth; j++) {
+                    auto it = names.find(s.frames[j]);
+                    if (it == names.end()) {
+                        it = names.emplace(s.frames[j],
+                                           symbolize(s.frames[j])).first;
+                    }
+                    if (j == 0)
+                        phase.self[it->second]++;
+                    if (seen.insert(it->second).second)
+                        phase.total[it->second]++;
+                }
+            }
+            phase.dropped = profile_n_dropped;
+
+            profile_n_samples = 0;
+            profile_n_dropped = 0;
+
+        }
+
+        void print_top(const char *kind,
+                       const std::map<std::string, size_t> &counts,
+                       size_t n_phase, int top_n) {
+
+            std::vector<std::pair<size_t, std::string>> sorted;
+            for (auto &c : counts)
+                sorted.emplace_back(c.second, c.first);
+            std::sort(sorted.begin(), sorted.end(),
+                      [](const std::pair<size_t, std::string> &a,
+                         const std::pair<size_t, std::string> &b) {
+                          return a.first > b.first;
+                      });
+
+            for (int i = 0; i < top_n && i < (int) sorted.size(); i++) {
+                std::cout << "@   " << kind << ' '
+                          << 100. * sorted[i].first / n_phase << "% "
+                          << sorted[i].second << std::endl;
+            }
+
+        }
+
+};
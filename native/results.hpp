@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Local store of benchmark results, used to detect performance changes
+ * between runs (e.g. across DAAL upgrades) with bench-compare.
+ *
+ * The store is a JSONL file with one record per timed function. Records
+ * are matched between runs by their key: function, benchmark parameters,
+ * data size, dataset hash, thread count and host fingerprint. Benchmarks
+ * which sweep values within a run (rather than through their parameters)
+ * must put them in the function name, e.g. df_clsf.fit.min_leaf_5, so
+ * that the samples of different configurations aren't pooled.
+ *
+ * Peak performance measured by the calibrate tool is kept per host and
+ * thread count in a separate store of the same format.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "json.hpp"
+
+
+#define DEFAULT_RESULTS_STORE "native/results/results.jsonl"
+#define DEFAULT_CALIBRATION_STORE "native/results/calibration.jsonl"
+
+
+/*
+ * FNV-1a hash, continuing from the given hash value.
+ */
+uint64_t fnv1a(const void *data, size_t len,
+               uint64_t hash = 14695981039346656037ULL) {
+
+    const unsigned char *bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+
+}
+
+
+std::string hex64(uint64_t x) {
+
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) x);
+    return buf;
+
+}
+
+
+struct host_info {
+    std::string hostname;
+    std::string cpu;
+    long n_cpus;
+
+    /* Identifies the machine results were measured on */
+    std::string fingerprint() const {
+        std::ostringstream s;
+        s << hostname << '|' << cpu << '|' << n_cpus;
+        std::string str = s.str();
+        return hex64(fnv1a(str.data(), str.size()));
+    }
+};
+
+
+host_info get_host_info() {
+
+    host_info info;
+
+    char hostname[256] = "";
+    gethostname(hostname, sizeof(hostname) - 1);
+    info.hostname = hostname;
+
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos && colon + 2 <= line.size())
+                info.cpu = line.substr(colon + 2);
+            break;
+        }
+    }
+
+    info.n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return info;
+
+}
+
+
+struct result_record {
+    std::string batch;
+    std::string prefix;
+    std::string function;
+    std::string params;
+    std::string size;
+    std::string dataset;
+    int threads;
+    std::string host;
+    std::string hostname;
+    std::string cpu;
+    std::string version;
+    double time;
+    std::vector<double> samples;
+
+    /* Records with the same key measure the same thing */
+    std::string key() const {
+        std::ostringstream s;
+        s << function << '|' << params << '|' << size << '|' << dataset
+          << '|' << threads << '|' << host;
+        return s.str();
+    }
+
+    std::string to_json() const {
+        std::ostringstream s;
+        s.precision(17);
+        s << "{\"batch\": " << json_quote(batch)
+          << ", \"prefix\": " << json_quote(prefix)
+          << ", \"function\": " << json_quote(function)
+          << ", \"params\": " << json_quote(params)
+          << ", \"size\": " << json_quote(size)
+          << ", \"dataset\": " << json_quote(dataset)
+          << ", \"threads\": " << threads
+          << ", \"host\": " << json_quote(host)
+          << ", \"hostname\": " << json_quote(hostname)
+          << ", \"cpu\": " << json_quote(cpu)
+          << ", \"version\": " << json_quote(version)
+          << ", \"time\": " << time
+          << ", \"samples\": [";
+        for (size_t i = 0; i < samples.size(); i++)
+            s << (i == 0 ? "" : ", ") << samples[i];
+        s << "]}";
+        return s.str();
+    }
+
+    static result_record from_json(const json_value &v) {
+        result_record r;
+        r.batch = v["batch"].to_string();
+        r.prefix = v["prefix"].to_string();
+        r.function = v["function"].to_string();
+        r.params = v["params"].to_string();
+        r.size = v["size"].to_string();
+        r.dataset = v["dataset"].to_string();
+        r.threads = (int) v["threads"].number;
+        r.host = v["host"].to_string();
+        r.hostname = v["hostname"].to_string();
+        r.cpu = v["cpu"].to_string();
+        r.version = v["version"].to_string();
+        r.time = v["time"].number;
+        for (auto &sample : v["samples"].array)
+            r.samples.push_back(sample.number);
+        return r;
+    }
+};
+
+
+/*
+ * Peak performance of a host measured by the calibrate tool, to which
+ * benchmark results are compared with --roofline.
+ */
+struct calibration_record {
+    std::string host;
+    std::string hostname;
+    std::string cpu;
+    int threads;
+    double triad_gbs;     // STREAM triad bandwidth
+    double dgemm_gflops;  // MKL DGEMM throughput
+    double sgemm_gflops;  // MKL SGEMM throughput
+    double latency_ns;    // Dependent load latency from DRAM
+
+    std::string to_json() const {
+        std::ostringstream s;
+        s << "{\"host\": " << json_quote(host)
+          << ", \"hostname\": " << json_quote(hostname)
+          << ", \"cpu\": " << json_quote(cpu)
+          << ", \"threads\": " << threads
+          << ", \"triad_gbs\": " << triad_gbs
+          << ", \"dgemm_gflops\": " << dgemm_gflops
+          << ", \"sgemm_gflops\": " << sgemm_gflops
+          << ", \"latency_ns\": " << latency_ns << '}';
+        return s.str();
+    }
+
+    static calibration_record from_json(const json_value &v) {
+        calibration_record r;
+        r.host = v["host"].to_string();
+        r.hostname = v["hostname"].to_string();
+        r.cpu = v["cpu"].to_string();
+        r.threads = (int) v["threads"].number;
+        r.triad_gbs = v["triad_gbs"].number;
+        r.dgemm_gflops = v["dgemm_gflops"].number;
+        r.sgemm_gflops = v["sgemm_gflops"].number;
+        r.latency_ns = v["latency_ns"].number;
+        return r;
+    }
+};
+
+
+/*
+ * Append a record (result_record or calibration_record) to a store,
+ * creating the directory holding it if needed. Returns false after
+ * printing an error on failure.
+ */
+template <typename Record>
+bool append_record(const std::string &path, const Record &record) {
+
+    for (size_t slash = path.find('/', 1); slash != std::string::npos;
+         slash = path.find('/', slash + 1))
+        mkdir(path.substr(0, slash).c_str(), 0777);
+
+    std::ofstream f(path, std::ios::app);
+    f << record.to_json() << std::endl;
+    if (!f) {
+        std::cerr << "error: failed to write results to " << path
+                  << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+
+/*
+ * Read all records from a store, in the order they were added.
+ * Throws std::runtime_error on failure.
+ */
+template <typename Record>
+std::vector<Record> load_records(const std::string &path) {
+
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("failed to open " + path);
+
+    std::vector<Record> records;
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty())
+            continue;
+        records.push_back(Record::from_json(parse_json(line)));
+    }
+    return records;
+
+}
+
+
+/*
+ * Find the latest calibration of this host with the given number of
+ * threads in the calibration store. Returns false if there is none.
+ */
+bool find_calibration(const std::string &path, int threads,
+                      calibration_record &calibration) {
+
+    std::vector<calibration_record> records;
+    try {
+        records = load_records<calibration_record>(path);
+    } catch (const std::runtime_error &e) {
+        return false;
+    }
+
+    std::string host = get_host_info().fingerprint();
+    bool found = false;
+    for (auto &r : records) {
+        if (r.host == host && r.threads == threads) {
+            calibration = r;
+            found = true;
+        }
+    }
+    return found;
+
+}
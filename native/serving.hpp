@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Open-loop simulation of a model serving predictions, to measure
+ * response time under a given offered load instead of the back-to-back
+ * call time measured by time_vec.
+ *
+ * A generator thread issues requests of a few rows of the data with
+ * Poisson arrivals at the target rate, independently of how fast they
+ * are served. Requests are queued and served by a pool of worker threads
+ * which call predict on the rows of one request, or of a micro-batch of
+ * queued requests. Response time is
+ * measured from the time a request was scheduled to arrive, so it
+ * includes queueing and isn't hidden by the generator falling behind.
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include "CLI11.hpp"
+#include "common.hpp"
+
+
+struct serving_options {
+    std::vector<double> qps;  // Offered loads to sweep, in requests/s
+    size_t batch_size;        // Rows per request
+    int workers;              // Threads serving requests
+    double duration;          // Seconds of arrivals per offered load
+    unsigned seed;
+    size_t max_batch;         // Rows per micro-batch, 0 to not batch
+    std::vector<double> max_wait; // Micro-batch waits to sweep, in us
+};
+
+
+void add_serving_args(CLI::App &app, struct serving_options &opts) {
+
+    app.add_option("--serve-qps", opts.qps,
+                   "Simulate serving predictions with Poisson arrivals at "
+                   "each of these rates (requests per second)");
+
+    opts.batch_size = 1;
+    app.add_option("--serve-batch-size", opts.batch_size,
+                   "Rows per serving request", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.workers = 1;
+    app.add_option("--serve-workers", opts.workers,
+                   "Threads serving requests", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.duration = 5.;
+    app.add_option("--serve-duration", opts.duration,
+                   "Seconds of arrivals for each offered load", true)
+        ->check(CLI::PositiveNumber);
+
+    opts.seed = 777;
+    app.add_option("--serve-seed", opts.seed,
+                   "Seed for the arrival process", true);
+
+    opts.max_batch = 0;
+    app.add_option("--serve-max-batch", opts.max_batch,
+                   "Combine queued requests into micro-batches of up to "
+                   "this many rows per predict call (0: one request per "
+                   "call)", true);
+
+    opts.max_wait = {0.};
+    app.add_option("--serve-max-wait", opts.max_wait,
+                   "Longest time in us a micro-batch waits for more "
+                   "requests before it is predicted, sweeping each value",
+                   true);
+
+}
+
+
+/*
+ * Nearest-rank percentile of sorted values, the ceil(p / 100 * n)th
+ * smallest: of 1..100, p50 is 50 and p99 is 99. Returns 0 if there are
+ * no values.
+ */
+double nearest_rank_percentile(const std::vector<double> &sorted, double p) {
+
+    if (sorted.empty())
+        return 0.;
+    // The tolerance keeps e.g. p99.9 of 1000 values, where p * n comes out
+    // a hair above 99900, at rank 999
+    double rank = std::ceil(p * sorted.size() / 100. - 1e-9);
+    size_t i = rank < 1. ? 0 : (size_t) rank - 1;
+    return sorted[std::min(i, sorted.size() - 1)];
+
+}
+
+
+struct serving_result {
+    double offered_qps;
+    double achieved_qps;     // Requests completed per second
+    size_t n_requests;
+    double mean_batch_rows;  // Rows per predict call
+    std::vector<double> latencies; // Sorted response times in seconds
+
+    /* Nearest-rank percentile of response time, in seconds */
+    double percentile(double p) const {
+        return nearest_rank_percentile(latencies, p);
+    }
+};
+
+
+/*
+ * Serve requests of opts.batch_size rows of X at the given offered load,
+ * calling predict(table) for each request.
+ *
+ * With micro-batching (opts.max_batch rows), a worker which takes a
+ * request keeps taking queued requests until the batch would exceed
+ * max_batch rows or max_wait_us has passed since it took the first. The
+ * rows of all requests are copied into the worker's preallocated buffer
+ * and predicted with one call, and the predictions are scattered back to
+ * the requests' result buffers.
+ */
+template <typename Predict>
+serving_result serve_open_loop(Predict predict, const double *X,
+                               size_t n_rows, size_t n_cols, double qps,
+                               double max_wait_us,
+                               const struct serving_options &opts) {
+
+    typedef std::chrono::steady_clock clock;
+
+    struct request {
+        size_t first_row;
+        clock::time_point arrival;
+    };
+
+    std::deque<request> queue;
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool done = false;
+
+    size_t batch_size = std::min(opts.batch_size, n_rows);
+    size_t max_requests = std::max(opts.max_batch / batch_size, (size_t) 1);
+    clock::duration max_wait = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double, std::micro>(max_wait_us));
+
+    std::vector<std::vector<double>> latencies(opts.workers);
+    std::vector<size_t> n_batches(opts.workers, 0);
+    clock::time_point start = clock::now();
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < opts.workers; w++) {
+        workers.emplace_back([&, w] {
+            std::vector<double> rows(max_requests * batch_size * n_cols);
+            std::vector<double> results;
+            std::vector<request> batch;
+            batch.reserve(max_requests);
+
+            while (true) {
+                batch.clear();
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&] { return done || !queue.empty(); });
+                    if (queue.empty())
+                        return;
+                    clock::time_point deadline = clock::now() + max_wait;
+                    while (batch.size() < max_requests) {
+                        ready.wait_until(lock, deadline, [&] {
+                                return done || !queue.empty();
+                            });
+                        if (queue.empty())
+                            break;
+                        batch.push_back(queue.front());
+                        queue.pop_front();
+                    }
+                }
+
+                dm::NumericTablePtr X_batch;
+                if (batch.size() == 1) {
+                    X_batch = make_table((double *) X
+                                         + batch[0].first_row * n_cols,
+                                         batch_size, n_cols);
+                } else {
+                    for (size_t i = 0; i < batch.size(); i++) {
+                        std::copy(X + batch[i].first_row * n_cols,
+                                  X + (batch[i].first_row + batch_size)
+                                  * n_cols,
+                                  rows.data() + i * batch_size * n_cols);
+                    }
+                    X_batch = make_table(rows.data(),
+                                         batch.size() * batch_size, n_cols);
+                }
+                dm::NumericTablePtr Y_batch = predict(X_batch);
+
+                // Each request gets its rows of the predictions
+                size_t n_out = Y_batch->getNumberOfColumns();
+                dm::BlockDescriptor<double> block;
+                Y_batch->getBlockOfRows(0, batch.size() * batch_size,
+                                        dm::readOnly, block);
+                const double *Y = block.getBlockPtr();
+                results.resize(batch.size() * batch_size * n_out);
+                for (size_t i = 0; i < batch.size(); i++) {
+                    std::copy(Y + i * batch_size * n_out,
+                              Y + (i + 1) * batch_size * n_out,
+                              results.data() + i * batch_size * n_out);
+                }
+                Y_batch->releaseBlockOfRows(block);
+
+                clock::time_point now = clock::now();
+                for (auto &r : batch) {
+                    latencies[w].push_back(std::chrono::duration<double>(
+                                now - r.arrival).count());
+                }
+                n_batches[w]++;
+            }
+        });
+    }
+
+    // Generate arrivals for the requested duration
+    std::mt19937_64 rng(opts.seed);
+    std::exponential_distribution<double> interarrival(qps);
+    clock::time_point end = start + std::chrono::duration_cast<
+        clock::duration>(std::chrono::duration<double>(opts.duration));
+    clock::time_point arrival = start;
+    size_t n_requests = 0;
+    while (true) {
+        arrival += std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(interarrival(rng)));
+        if (arrival >= end)
+            break;
+        std::this_thread::sleep_until(arrival);
+
+        size_t first_row = (n_requests * batch_size)
+            % (n_rows - batch_size + 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({first_row, arrival});
+        }
+        ready.notify_one();
+        n_requests++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    ready.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+    double elapsed = std::chrono::duration<double>(
+            clock::now() - start).count();
+
+    serving_result result;
+    result.offered_qps = qps;
+    result.n_requests = n_requests;
+    result.achieved_qps = n_requests / elapsed;
+    size_t total_batches = 0;
+    for (size_t b : n_batches)
+        total_batches += b;
+    result.mean_batch_rows = total_batches
+        ? (double) n_requests * batch_size / total_batches : 0.;
+    for (auto &l : latencies)
+        result.latencies.insert(result.latencies.end(), l.begin(), l.end());
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Monitor of how busy TBB threads are while DAAL computes, to tell how
+ * much of the requested parallelism an algorithm actually uses.
+ *
+ * The monitor is a local task_scheduler_observer on the arena of the
+ * thread which starts it, which is the arena DAAL runs its parallel
+ * regions in. TBB notifies it whenever a thread joins or leaves that
+ * arena, so a thread's active time is the time it spends in the arena,
+ * including the short time workers spin looking for work before they
+ * leave.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#if !defined(TBB_PREVIEW_LOCAL_OBSERVER)
+#define TBB_PREVIEW_LOCAL_OBSERVER 1
+#endif
+#include "tbb/task_scheduler_observer.h"
+#include "tbb/task_arena.h"
+// oneTBB moved TBB_INTERFACE_VERSION from tbb_stddef.h to version.h
+#if __has_include("tbb/version.h")
+#include "tbb/version.h"
+#else
+#include "tbb/tbb_stddef.h"
+#endif
+
+
+struct utilization_report {
+    int threads;                // Arena slots, i.e. threads requested
+    double wall_time;           // Duration of the monitored region
+    std::vector<double> active; // Active time of each arena slot
+    std::vector<size_t> entries; // Times each slot's thread joined
+    std::vector<size_t> exits;   // Times each slot's thread left
+
+    // Sum of active time over wall time
+    double effective_parallelism() const {
+        double total = 0.;
+        for (double t : active)
+            total += t;
+        return wall_time > 0. ? total / wall_time : 0.;
+    }
+
+    // Max over mean active time of threads which were active at all
+    double imbalance() const {
+        double total = 0., max = 0.;
+        int n_active = 0;
+        for (double t : active) {
+            if (t > 0.) {
+                total += t;
+                max = std::max(max, t);
+                n_active++;
+            }
+        }
+        return total > 0. ? max / (total / n_active) : 0.;
+    }
+
+    double idle_fraction() const {
+        return 1. - effective_parallelism() / threads;
+    }
+};
+
+
+class utilization_monitor : public tbb::task_scheduler_observer {
+
+    public:
+        // Observe the arena of the thread calling start()
+#if TBB_INTERFACE_VERSION >= 12000
+        utilization_monitor() : tbb::task_scheduler_observer() {}
+#else
+        utilization_monitor() : tbb::task_scheduler_observer(true) {}
+#endif
+
+        ~utilization_monitor() { observe(false); }
+
+        void start() {
+
+            n_slots = tbb::this_task_arena::max_concurrency();
+            slots.reset(new slot[n_slots]);
+            begin = now_ns();
+            observe(true);
+
+        }
+
+        utilization_report stop() {
+
+            observe(false);
+            uint64_t end = now_ns();
+
+            utilization_report report;
+            report.threads = n_slots;
+            report.wall_time = (end - begin) * 1e-9;
+            for (int i = 0; i < n_slots; i++) {
+                uint64_t active = slots[i].active_ns;
+                // Threads still in the arena count as active until now
+                if (slots[i].entered_ns)
+                    active += end - slots[i].entered_ns;
+                report.active.push_back(active * 1e-9);
+                report.entries.push_back(slots[i].entries);
+                report.exits.push_back(slots[i].exits);
+            }
+            return report;
+
+        }
+
+        void on_scheduler_entry(bool is_worker) override {
+
+            slot *s = this_slot();
+            if (s) {
+                s->entered_ns = now_ns();
+                s->entries++;
+            }
+
+        }
+
+        void on_scheduler_exit(bool is_worker) override {
+
+            slot *s = this_slot();
+            if (s && s->entered_ns) {
+                s->active_ns += now_ns() - s->entered_ns;
+                s->entered_ns = 0;
+                s->exits++;
+            }
+
+        }
+
+    private:
+        // Each slot is only written by the thread occupying it
+        struct alignas(64) slot {
+            std::atomic<uint64_t> active_ns{0};
+            std::atomic<uint64_t> entered_ns{0};
+            std::atomic<size_t> entries{0};
+            std::atomic<size_t> exits{0};
+        };
+
+        std::unique_ptr<slot[]> slots;
+        int n_slots = 0;
+        uint64_t begin = 0;
+
+        static uint64_t now_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        slot *this_slot() {
+            int i = tbb::this_task_arena::current_thread_index();
+            return (i >= 0 && i < n_slots) ? &slots[i] : NULL;
+        }
+
+};
+
+
+/*
+ * Print a utilization report for the given function, with the activity
+ * of each thread if verbose.
+ */
+void print_utilization(const std::string &function,
+                       const utilization_report &report, bool verbose) {
+
+    std::cout << "@ " << function << " utilization: " << report.threads
+              << " threads requested, " << report.effective_parallelism()
+              << " effective, " << 100. * report.idle_fraction()
+              << "% idle, imbalance " << report.imbalance()
+              << " (max/mean active time)" << std::endl;
+
+    if (verbose) {
+        for (size_t i = 0; i < report.active.size(); i++) {
+            std::cout << "@   thread " << i << ": active "
+                      << report.active[i] << "s ("
+                      << 100. * report.active[i] / report.wall_time
+                      << "%), " << report.entries[i] << " entries, "
+                      << report.exits[i] << " exits" << std::endl;
+        }
+    }
+
+}